@@ -0,0 +1,31 @@
+#ifndef ERROR_HANDLING_ALLOC_ERROR_H_
+#define ERROR_HANDLING_ALLOC_ERROR_H_
+
+#include "result.h"
+
+// 内存分配失败的错误，由 Try 开头的可能分配内存的操作返回，而不是抛出 std::bad_alloc
+enum class AllocErrorCode {
+    kOutOfMemory = 1,  // 分配失败
+    kLengthError,      // 请求的大小超出了容器能表示的范围
+};
+
+using AllocError = TypedError<AllocErrorCode>;
+
+namespace alloc_error_internal {
+
+// 构造错误对象本身也要分配内存，内存耗尽时可能分配不出来，所以在启动时预先构造好，
+// 出错时只是拷贝（增加引用计数）
+inline const AllocError kOutOfMemoryError(AllocErrorCode::kOutOfMemory);
+inline const AllocError kLengthError(AllocErrorCode::kLengthError);
+
+} // namespace alloc_error_internal
+
+inline const AllocError& OutOfMemoryError() {
+    return alloc_error_internal::kOutOfMemoryError;
+}
+
+inline const AllocError& LengthError() {
+    return alloc_error_internal::kLengthError;
+}
+
+#endif // ERROR_HANDLING_ALLOC_ERROR_H_
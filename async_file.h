@@ -0,0 +1,562 @@
+#ifndef ERROR_HANDLING_ASYNC_FILE_H_
+#define ERROR_HANDLING_ASYNC_FILE_H_
+
+// 异步的文件打开和读取，优先用 io_uring，不可用时退回到线程池里的 pread：
+//
+//   std::unique_ptr<AsyncFileIo> io = CreateAsyncFileIo();
+//   io->Open("data.bin", [](Result<File, ErrnoError> file) { ... });      // 回调
+//   io->Read(fd, buffer, 4096, offset, [](Result<std::size_t, ErrnoError> n) { ... });
+//   io->Flush();                                                         // 提交上面排队的请求
+//
+//   Task<std::size_t, ErrnoError> ReadHeader(AsyncFileIo& io, const std::string& path, char* buffer) {
+//       File file = co_await co_await io.Open(path);                      // 协程里等待
+//       co_return co_await co_await io.Read(file.Fd(), buffer, 512, 0);
+//   }
+//
+// io_uring 直接通过系统调用使用，不依赖 liburing。请求先放进提交队列，排满 batch_size 个
+// 或调用 Flush 时一次 io_uring_enter 全部提交；协程的等待默认立即提交，在 AsyncFileIo::Batch
+// 的作用域内则推迟到作用域结束时一起提交。完成事件由一个专门的线程收割，回调和协程的恢复
+// 都在这个线程里执行，耗时的处理应该转到别的线程。线程池后端的回调在线程池的线程里执行。
+//
+// 销毁 AsyncFileIo 之前，所有提交的请求都必须已经完成。
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "errno_error.h"
+#include "file.h"
+#include "result.h"
+#include "task.h"
+#include "thread_pool.h"
+
+// 一个正在进行的请求。完成时以系统调用的结果调用 Complete：非负数表示成功，负数为 -errno
+class IoOperation {
+public:
+    virtual void Complete(int result) = 0;
+
+protected:
+    ~IoOperation() = default;
+};
+
+class AsyncFileIo {
+public:
+    virtual ~AsyncFileIo() = default;
+
+    // 后端的名字，"io_uring" 或 "pread"
+    virtual const char* Name() const = 0;
+
+    // 提交请求，完成时调用 op->Complete。path 在完成前必须保持有效
+    virtual void SubmitOpen(const char* path, int flags, IoOperation* op) = 0;
+    virtual void SubmitRead(int fd, void* buffer, std::size_t size, uint64_t offset, IoOperation* op) = 0;
+
+    // 把排队的请求提交给内核
+    virtual void Flush() = 0;
+
+    // 打开文件，完成时以 Result<File, ErrnoError> 调用 callback
+    template <typename Callback>
+    void Open(std::string path, Callback callback, int flags = O_RDONLY) {
+        auto* op = new CallbackOpen<Callback>(std::move(path), std::move(callback));
+        SubmitOpen(op->path.c_str(), flags, op);
+    }
+
+    // 从 offset 处读取最多 size 个字节，完成时以 Result<std::size_t, ErrnoError> 调用 callback
+    template <typename Callback>
+    void Read(int fd, void* buffer, std::size_t size, uint64_t offset, Callback callback) {
+        SubmitRead(fd, buffer, size, offset, new CallbackRead<Callback>(std::move(callback)));
+    }
+
+    class OpenAwaiter;
+    class ReadAwaiter;
+
+    // 在协程里等待，co_await 的结果是 Result<File, ErrnoError>
+    OpenAwaiter Open(std::string path, int flags = O_RDONLY);
+    // 在协程里等待，co_await 的结果是 Result<std::size_t, ErrnoError>
+    ReadAwaiter Read(int fd, void* buffer, std::size_t size, uint64_t offset);
+
+    // 作用域内本线程发起的协程等待只排队，作用域结束时一起提交
+    class Batch {
+    public:
+        explicit Batch(AsyncFileIo& io) : io_(io) {
+            ++Depth();
+        }
+        ~Batch() {
+            if (--Depth() == 0) io_.Flush();
+        }
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+        static int& Depth() {
+            thread_local int depth = 0;
+            return depth;
+        }
+
+    private:
+        AsyncFileIo& io_;
+    };
+
+protected:
+    static Result<File, ErrnoError> MakeOpenResult(int result) {
+        if (result < 0) return ErrnoError(ErrnoType(-result));
+        return File(result);
+    }
+    static Result<std::size_t, ErrnoError> MakeReadResult(int result) {
+        if (result < 0) return ErrnoError(ErrnoType(-result));
+        return static_cast<std::size_t>(result);
+    }
+
+    // 协程的等待在提交后调用，不在 Batch 作用域内时立即提交
+    void FlushUnlessBatching() {
+        if (Batch::Depth() == 0) Flush();
+    }
+
+private:
+    template <typename Callback>
+    struct CallbackOpen final : IoOperation {
+        CallbackOpen(std::string p, Callback c) : path(std::move(p)), callback(std::move(c)) {}
+        void Complete(int result) override {
+            callback(MakeOpenResult(result));
+            delete this;
+        }
+        std::string path;
+        Callback callback;
+    };
+
+    template <typename Callback>
+    struct CallbackRead final : IoOperation {
+        explicit CallbackRead(Callback c) : callback(std::move(c)) {}
+        void Complete(int result) override {
+            callback(MakeReadResult(result));
+            delete this;
+        }
+        Callback callback;
+    };
+};
+
+// 等待对象本身就是请求，不需要额外分配内存
+class AsyncFileIo::OpenAwaiter final : IoOperation {
+public:
+    OpenAwaiter(AsyncFileIo& io, std::string path, int flags)
+        : io_(io), path_(std::move(path)), flags_(flags) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        // 提交后请求可能已经完成，协程可能已经恢复而销毁了本对象，不能再访问成员
+        AsyncFileIo& io = io_;
+        io.SubmitOpen(path_.c_str(), flags_, this);
+        io.FlushUnlessBatching();
+    }
+    Result<File, ErrnoError> await_resume() {
+        return MakeOpenResult(result_);
+    }
+
+private:
+    void Complete(int result) override {
+        result_ = result;
+        handle_.resume();
+    }
+
+    AsyncFileIo& io_;
+    std::string path_;
+    int flags_;
+    int result_ = 0;
+    std::coroutine_handle<> handle_;
+};
+
+class AsyncFileIo::ReadAwaiter final : IoOperation {
+public:
+    ReadAwaiter(AsyncFileIo& io, int fd, void* buffer, std::size_t size, uint64_t offset)
+        : io_(io), fd_(fd), buffer_(buffer), size_(size), offset_(offset) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        AsyncFileIo& io = io_;
+        io.SubmitRead(fd_, buffer_, size_, offset_, this);
+        io.FlushUnlessBatching();
+    }
+    Result<std::size_t, ErrnoError> await_resume() {
+        return MakeReadResult(result_);
+    }
+
+private:
+    void Complete(int result) override {
+        result_ = result;
+        handle_.resume();
+    }
+
+    AsyncFileIo& io_;
+    int fd_;
+    void* buffer_;
+    std::size_t size_;
+    uint64_t offset_;
+    int result_ = 0;
+    std::coroutine_handle<> handle_;
+};
+
+inline AsyncFileIo::OpenAwaiter AsyncFileIo::Open(std::string path, int flags) {
+    return OpenAwaiter(*this, std::move(path), flags);
+}
+
+inline AsyncFileIo::ReadAwaiter AsyncFileIo::Read(int fd, void* buffer, std::size_t size, uint64_t offset) {
+    return ReadAwaiter(*this, fd, buffer, size, offset);
+}
+
+// 基于 io_uring 的实现
+class IoUringFileIo final : public AsyncFileIo {
+public:
+    // 内核不支持或被禁止（比如在容器里被 seccomp 拦截）时返回错误
+    static Result<std::unique_ptr<IoUringFileIo>, ErrnoError> Create(unsigned entries = 256,
+                                                                     unsigned batch_size = 32) {
+        std::unique_ptr<IoUringFileIo> io(new IoUringFileIo(batch_size));
+        auto setup = io->Setup(entries);
+        if (!setup.OK()) return setup.Error();
+        io->reaper_ = std::thread([raw = io.get()] { raw->Reap(); });
+        return io;
+    }
+
+    ~IoUringFileIo() override {
+        if (reaper_.joinable()) {
+            // 提交一个空操作唤醒收割线程让它退出
+            std::unique_lock<std::mutex> lock(mutex_);
+            io_uring_sqe* sqe = NextSqe(lock);
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = 0;
+            ++local_tail_;
+            FlushLocked();
+            lock.unlock();
+            reaper_.join();
+        }
+        if (sqes_) ::munmap(sqes_, sqes_size_);
+        if (cq_ring_ && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_) ::munmap(sq_ring_, sq_ring_size_);
+        if (ring_fd_ >= 0) ::close(ring_fd_);
+    }
+
+    const char* Name() const override {
+        return "io_uring";
+    }
+
+    void SubmitOpen(const char* path, int flags, IoOperation* op) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        io_uring_sqe* sqe = NextSqe(lock);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(path);
+        sqe->open_flags = flags | O_CLOEXEC;
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+        QueuedLocked();
+        FinishFailed(lock);
+    }
+
+    void SubmitRead(int fd, void* buffer, std::size_t size, uint64_t offset, IoOperation* op) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        io_uring_sqe* sqe = NextSqe(lock);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        // len 只有 32 位，太大的读取截断成一次普通的短读，和 read 的上限一致
+        sqe->len = static_cast<unsigned>(std::min<std::size_t>(size, INT_MAX & ~4095));
+        sqe->off = offset;
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+        QueuedLocked();
+        FinishFailed(lock);
+    }
+
+    void Flush() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        FlushLocked();
+        FinishFailed(lock);
+    }
+
+private:
+    explicit IoUringFileIo(unsigned batch_size) : batch_size_(batch_size == 0 ? 1 : batch_size) {}
+
+    static int Setup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+    int Enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags,
+                                          nullptr, 0));
+    }
+
+    template <typename Pointer>
+    static Pointer At(void* base, unsigned offset) {
+        return reinterpret_cast<Pointer>(static_cast<char*>(base) + offset);
+    }
+
+    Result<void, ErrnoError> Setup(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = Setup(entries, &params);
+        if (ring_fd_ < 0) return ErrnoError(ErrnoType(errno));
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        sq_ring_ = MapRing(sq_ring_size_, IORING_OFF_SQ_RING);
+        if (!sq_ring_) return ErrnoError(ErrnoType(errno));
+        cq_ring_ = single_mmap ? sq_ring_ : MapRing(cq_ring_size_, IORING_OFF_CQ_RING);
+        if (!cq_ring_) return ErrnoError(ErrnoType(errno));
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(MapRing(sqes_size_, IORING_OFF_SQES));
+        if (!sqes_) return ErrnoError(ErrnoType(errno));
+
+        sq_entries_ = params.sq_entries;
+        cq_entries_ = params.cq_entries;
+        sq_head_ = At<unsigned*>(sq_ring_, params.sq_off.head);
+        sq_tail_ = At<unsigned*>(sq_ring_, params.sq_off.tail);
+        sq_mask_ = *At<unsigned*>(sq_ring_, params.sq_off.ring_mask);
+        cq_head_ = At<unsigned*>(cq_ring_, params.cq_off.head);
+        cq_tail_ = At<unsigned*>(cq_ring_, params.cq_off.tail);
+        cq_mask_ = *At<unsigned*>(cq_ring_, params.cq_off.ring_mask);
+        cqes_ = At<io_uring_cqe*>(cq_ring_, params.cq_off.cqes);
+        // 提交队列的下标数组固定为恒等映射，第 i 个槽位就用第 i 个 SQE
+        unsigned* array = At<unsigned*>(sq_ring_, params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i) array[i] = i;
+        local_tail_ = *sq_tail_;
+        return ProbeOpcodes();
+    }
+
+    // 5.1~5.5 的内核有 io_uring 但是没有 OPENAT/READ，用到的操作不支持（或者内核连探测都不支持）时
+    // 返回错误，让 CreateAsyncFileIo 退回到 pread
+    Result<void, ErrnoError> ProbeOpcodes() {
+        constexpr unsigned kOps = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, kOps) < 0)
+            return ErrnoError(ErrnoType(errno));
+        for (unsigned op : {IORING_OP_OPENAT, IORING_OP_READ}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                return ErrnoError(ErrnoType(EOPNOTSUPP));
+        }
+        return Result<void, ErrnoError>();
+    }
+
+    void* MapRing(std::size_t size, off_t offset) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    // 取一个空闲的 SQE。提交队列满了就先提交；正在进行的请求太多时等待完成，以免完成队列溢出。
+    // 回调和恢复的协程都在收割线程里运行，只有它会减少 in_flight_，所以它不能等待，改为就地收割
+    io_uring_sqe* NextSqe(std::unique_lock<std::mutex>& lock) {
+        if (local_tail_ - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire) == sq_entries_)
+            FlushLocked();
+        if (std::this_thread::get_id() == reaper_.get_id()) {
+            while (in_flight_ >= cq_entries_) ReapInlineLocked();
+        } else {
+            capacity_cv_.wait(lock, [&] { return in_flight_ < cq_entries_; });
+        }
+        ++in_flight_;
+        io_uring_sqe* sqe = &sqes_[local_tail_ & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    void QueuedLocked() {
+        ++local_tail_;
+        if (local_tail_ - submitted_ >= batch_size_) FlushLocked();
+    }
+
+    void FlushLocked() {
+        unsigned to_submit = local_tail_ - submitted_;
+        if (to_submit == 0) return;
+        std::atomic_ref<unsigned>(*sq_tail_).store(local_tail_, std::memory_order_release);
+        while (to_submit > 0) {
+            int n = Enter(to_submit, 0, 0);
+            if (n < 0) {
+                // 完成队列暂时满了等情况，稍后重试
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                DropUnsubmittedLocked(errno);
+                return;
+            }
+            to_submit -= n;
+            submitted_ += n;
+        }
+    }
+
+    // io_uring_enter 出错时内核没有取走剩下的 SQE：把它们从提交队列里撤回，腾出位置，
+    // 对应的请求记下错误，解锁后由 FinishFailed 以 -error 完成，以免等待者一直挂起
+    void DropUnsubmittedLocked(int error) {
+        for (unsigned i = submitted_; i != local_tail_; ++i) {
+            const uint64_t user_data = sqes_[i & sq_mask_].user_data;
+            if (user_data != 0) failed_.emplace_back(reinterpret_cast<IoOperation*>(user_data), error);
+        }
+        in_flight_ -= local_tail_ - submitted_;
+        local_tail_ = submitted_;
+        std::atomic_ref<unsigned>(*sq_tail_).store(local_tail_, std::memory_order_release);
+        capacity_cv_.notify_all();
+    }
+
+    // 在锁外完成提交失败的请求，回调里可以继续提交
+    void FinishFailed(std::unique_lock<std::mutex>& lock) {
+        if (failed_.empty()) return;
+        std::vector<std::pair<IoOperation*, int>> failed;
+        failed.swap(failed_);
+        lock.unlock();
+        for (auto& [op, error] : failed) op->Complete(-error);
+    }
+
+    // 收割线程在回调里提交请求而 in_flight_ 已满时调用：先提交已经填好的请求，再把完成事件
+    // 拷到 deferred_ 里腾出空间，这些事件等当前的回调返回后再处理
+    void ReapInlineLocked() {
+        FlushLocked();
+        unsigned head = std::atomic_ref<unsigned>(*cq_head_).load(std::memory_order_relaxed);
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        if (head == tail) {
+            Enter(0, 1, IORING_ENTER_GETEVENTS);
+            return;
+        }
+        in_flight_ -= tail - head;
+        for (; head != tail; ++head) deferred_.push_back(cqes_[head & cq_mask_]);
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+        capacity_cv_.notify_all();
+    }
+
+    // 先把完成事件拷出来并归还完成队列的空间，再调用各请求的 Complete，
+    // 这样回调里可以继续提交新的请求
+    void Reap() {
+        for (;;) {
+            reaped_.clear();
+            if (!deferred_.empty()) {
+                reaped_.swap(deferred_);
+            } else {
+                unsigned head = std::atomic_ref<unsigned>(*cq_head_).load(std::memory_order_relaxed);
+                unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+                if (head == tail) {
+                    Enter(0, 1, IORING_ENTER_GETEVENTS);
+                    continue;
+                }
+                for (; head != tail; ++head) reaped_.push_back(cqes_[head & cq_mask_]);
+                std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    in_flight_ -= static_cast<unsigned>(reaped_.size());
+                }
+                capacity_cv_.notify_all();
+            }
+
+            bool stop = false;
+            for (const io_uring_cqe& cqe : reaped_) {
+                if (cqe.user_data == 0)
+                    stop = true;
+                else
+                    reinterpret_cast<IoOperation*>(cqe.user_data)->Complete(cqe.res);
+            }
+            if (stop) return;
+        }
+    }
+
+    const unsigned batch_size_;
+    int ring_fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sq_ring_size_ = 0, cq_ring_size_ = 0, sqes_size_ = 0;
+    unsigned sq_entries_ = 0, cq_entries_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::mutex mutex_;
+    std::condition_variable capacity_cv_;
+    unsigned local_tail_ = 0;  // 已经填好的 SQE，还没有全部告诉内核
+    unsigned submitted_ = 0;   // 已经提交给内核的 SQE
+    unsigned in_flight_ = 0;   // 已经填好但还没有收割的请求
+    std::thread reaper_;
+    std::vector<io_uring_cqe> reaped_;    // 只由收割线程使用
+    std::vector<io_uring_cqe> deferred_;  // 回调里就地收割的完成事件，只由收割线程使用
+    std::vector<std::pair<IoOperation*, int>> failed_;  // 提交失败的请求和 errno
+};
+
+// 在线程池里用 open/pread 同步执行的实现，没有批量提交，Flush 什么也不做
+class PreadFileIo final : public AsyncFileIo {
+public:
+    explicit PreadFileIo(int num_threads = 4) : pool_(num_threads) {}
+
+    const char* Name() const override {
+        return "pread";
+    }
+
+    void SubmitOpen(const char* path, int flags, IoOperation* op) override {
+        RunOpen(pool_, path, flags, op);
+    }
+
+    void SubmitRead(int fd, void* buffer, std::size_t size, uint64_t offset, IoOperation* op) override {
+        RunRead(pool_, fd, buffer, size, offset, op);
+    }
+
+    void Flush() override {}
+
+private:
+    static DetachedTask RunOpen(ThreadPool& pool, const char* path, int flags, IoOperation* op) {
+        co_await pool.Schedule();
+        int fd;
+        do {
+            fd = ::open(path, flags | O_CLOEXEC);
+        } while (fd < 0 && errno == EINTR);
+        op->Complete(fd < 0 ? -errno : fd);
+    }
+
+    static DetachedTask RunRead(ThreadPool& pool, int fd, void* buffer, std::size_t size, uint64_t offset,
+                                IoOperation* op) {
+        co_await pool.Schedule();
+        ssize_t n;
+        do {
+            n = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+        } while (n < 0 && errno == EINTR);
+        op->Complete(n < 0 ? -errno : static_cast<int>(n));
+    }
+
+    ThreadPool pool_;
+};
+
+struct AsyncFileIoOptions {
+    unsigned entries = 256;     // io_uring 提交队列的大小
+    unsigned batch_size = 32;   // 排队到这么多个请求时自动提交
+    int fallback_threads = 4;   // 退回到 pread 时线程池的线程数
+    bool force_fallback = false;
+};
+
+// 优先创建 io_uring 的实现，失败时退回到线程池加 pread
+inline std::unique_ptr<AsyncFileIo> CreateAsyncFileIo(const AsyncFileIoOptions& options = {}) {
+    if (!options.force_fallback) {
+        auto io = IoUringFileIo::Create(options.entries, options.batch_size);
+        if (io.OK()) return std::move(io.Value());
+    }
+    return std::make_unique<PreadFileIo>(options.fallback_threads);
+}
+
+#endif // ERROR_HANDLING_ASYNC_FILE_H_
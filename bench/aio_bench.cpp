@@ -0,0 +1,169 @@
+// AsyncFileIo（async_file.h）的随机读吞吐量，和同步的 pread 对比
+//
+// 在临时文件里随机读取 4KB 的块，文件在页缓存里，所以测的主要是每个请求的开销。
+// 异步的后端每次保持 depth 个请求在进行中，分别用回调和协程两种方式等待完成。
+// 每个块的内容都是可以校验的，先核对读到的数据和错误码，再计时。
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "async_file.h"
+
+namespace {
+
+constexpr std::size_t kBlock = 4096;
+
+// 第 i 块的内容都是 i % 251
+unsigned char BlockByte(uint64_t offset) {
+    return static_cast<unsigned char>(offset / kBlock % 251);
+}
+
+int MakeFile(std::size_t blocks) {
+    char path[] = "/tmp/aio_bench_XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd < 0) {
+        std::perror("mkstemp");
+        std::exit(1);
+    }
+    ::unlink(path);
+    std::vector<unsigned char> block(kBlock);
+    for (std::size_t i = 0; i < blocks; ++i) {
+        std::memset(block.data(), BlockByte(i * kBlock), kBlock);
+        if (::write(fd, block.data(), kBlock) != static_cast<ssize_t>(kBlock)) {
+            std::perror("write");
+            std::exit(1);
+        }
+    }
+    return fd;
+}
+
+struct Counter {
+    std::atomic<std::size_t> done{0};
+    std::atomic<std::size_t> bad{0};
+
+    void Check(const Result<std::size_t, ErrnoError>& n, const unsigned char* buffer, uint64_t offset) {
+        if (!n.OK() || n.Value() != kBlock || buffer[0] != BlockByte(offset) ||
+            buffer[kBlock - 1] != BlockByte(offset))
+            bad.fetch_add(1, std::memory_order_relaxed);
+        done.fetch_add(1, std::memory_order_release);
+        done.notify_one();
+    }
+
+    void WaitFor(std::size_t target) {
+        for (std::size_t now = done.load(std::memory_order_acquire); now < target;
+             now = done.load(std::memory_order_acquire))
+            done.wait(now);
+    }
+};
+
+DetachedTask ReadOne(AsyncFileIo& io, int fd, unsigned char* buffer, uint64_t offset, Counter& counter) {
+    auto n = co_await io.Read(fd, buffer, kBlock, offset);
+    counter.Check(n, buffer, offset);
+}
+
+template <typename Function>
+double OpsPerSecond(std::size_t ops, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return ops / elapsed.count();
+}
+
+// 分批发起读取，每批 depth 个，等一批都完成后再发下一批
+void RunAsync(AsyncFileIo& io, int fd, const std::vector<uint64_t>& offsets, std::size_t depth,
+              bool coroutine, Counter& counter) {
+    std::vector<unsigned char> buffers(depth * kBlock);
+    for (std::size_t begin = 0; begin < offsets.size(); begin += depth) {
+        std::size_t end = std::min(offsets.size(), begin + depth);
+        if (coroutine) {
+            AsyncFileIo::Batch batch(io);
+            for (std::size_t i = begin; i < end; ++i)
+                ReadOne(io, fd, &buffers[(i - begin) * kBlock], offsets[i], counter);
+        } else {
+            for (std::size_t i = begin; i < end; ++i) {
+                unsigned char* buffer = &buffers[(i - begin) * kBlock];
+                uint64_t offset = offsets[i];
+                io.Read(fd, buffer, kBlock, offset, [&counter, buffer, offset](Result<std::size_t, ErrnoError> n) {
+                    counter.Check(n, buffer, offset);
+                });
+            }
+            io.Flush();
+        }
+        counter.WaitFor(end);
+    }
+}
+
+void CheckErrors(AsyncFileIo& io) {
+    std::atomic<int> open_error{-1}, read_error{-1};
+    io.Open("/nonexistent/aio_bench", [&](Result<File, ErrnoError> file) {
+        open_error = file.OK() ? 0 : static_cast<int>(file.Error().Code());
+        open_error.notify_one();
+    });
+    char buffer[16];
+    io.Read(-1, buffer, sizeof(buffer), 0, [&](Result<std::size_t, ErrnoError> n) {
+        read_error = n.OK() ? 0 : static_cast<int>(n.Error().Code());
+        read_error.notify_one();
+    });
+    io.Flush();
+    open_error.wait(-1);
+    read_error.wait(-1);
+    if (open_error != ENOENT || read_error != EBADF) {
+        std::fprintf(stderr, "%s: unexpected errors open=%d read=%d\n", io.Name(), open_error.load(),
+                     read_error.load());
+        std::exit(1);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t ops = argc > 1 ? std::atol(argv[1]) : 200000;
+    const std::size_t blocks = 16384;  // 64MB
+    int fd = MakeFile(blocks);
+
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> offsets(ops);
+    for (auto& offset : offsets) offset = rng() % blocks * kBlock;
+
+    std::printf("reads=%zu block=%zu file=%zuMB\n", ops, kBlock, blocks * kBlock >> 20);
+    std::vector<unsigned char> buffer(kBlock);
+    double sync = OpsPerSecond(ops, [&] {
+        for (uint64_t offset : offsets) {
+            if (::pread(fd, buffer.data(), kBlock, offset) != static_cast<ssize_t>(kBlock) ||
+                buffer[0] != BlockByte(offset))
+                std::abort();
+        }
+    });
+    std::printf("  %-28s %8.0f Kops/s\n", "sync pread", sync / 1e3);
+
+    AsyncFileIoOptions fallback;
+    fallback.force_fallback = true;
+    std::unique_ptr<AsyncFileIo> backends[] = {CreateAsyncFileIo(), CreateAsyncFileIo(fallback)};
+    for (auto& io : backends) {
+        CheckErrors(*io);
+        for (std::size_t depth : {1, 8, 64}) {
+            for (bool coroutine : {false, true}) {
+                Counter counter;
+                double rate = OpsPerSecond(ops, [&] { RunAsync(*io, fd, offsets, depth, coroutine, counter); });
+                if (counter.bad != 0) {
+                    std::fprintf(stderr, "%s: %zu bad reads\n", io->Name(), counter.bad.load());
+                    return 1;
+                }
+                char label[64];
+                std::snprintf(label, sizeof(label), "%s %s depth=%zu", io->Name(),
+                              coroutine ? "co_await" : "callback", depth);
+                std::printf("  %-28s %8.0f Kops/s  (%.2fx)\n", label, rate / 1e3, rate / sync);
+            }
+        }
+    }
+    ::close(fd);
+}
@@ -0,0 +1,162 @@
+// CircuitBreaker（circuit_breaker.h）关闭状态下每次调用的额外开销
+//
+// 被包装的调用只做很少的计算，测的主要是放行检查和记录结果的开销，和直接调用对比，
+// 线程数从 1 到 16。计时之前先检查断路器的状态转换：按比例和 min_calls 打开、
+// 阈值大于 1 的错误码既不打开断路器也不使探测失败、打开 → 半开 → 关闭以及探测失败时重新打开、
+// 原始错误码相同但错误域不同的错误分开计数。
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "cancellation.h"
+#include "circuit_breaker.h"
+#include "errno_error.h"
+
+namespace {
+
+using Outcome = Result<int, GenericError>;
+
+Outcome Ok() {
+    return 1;
+}
+
+Outcome Fail(GenericError error) {
+    return error;
+}
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+CircuitBreakerOptions TestOptions() {
+    CircuitBreakerOptions options;
+    options.min_calls = 10;
+    options.failure_ratio = 0.5;
+    options.open_duration = std::chrono::milliseconds(20);
+    options.half_open_probes = 2;
+    return options;
+}
+
+void WaitForHalfOpen() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+}
+
+bool IsCircuitOpen(const Outcome& r) {
+    return !r.OK() && r.Error().Domain() == ErrorDomain<CircuitErrorCode>() &&
+           r.Error().Code() == static_cast<int>(CircuitErrorCode::kCircuitOpen);
+}
+
+bool CheckBehavior() {
+    bool ok = true;
+    const GenericError eio = ErrnoError(ErrnoType(EIO));
+    const GenericError enoent = ErrnoError(ErrnoType(ENOENT));
+
+    {
+        // 6 次成功之后，第 6 次失败时失败比例 6/12 才达到 0.5；调用总数不到 min_calls 时不打开
+        CircuitBreaker breaker(TestOptions());
+        for (int i = 0; i < 6; ++i) (void)breaker.Call(Ok);
+        for (int i = 0; i < 5; ++i) (void)breaker.Call([&] { return Fail(eio); });
+        ok &= Expect(breaker.State() == CircuitState::kClosed, "below the ratio stays closed");
+        (void)breaker.Call([&] { return Fail(eio); });
+        ok &= Expect(breaker.State() == CircuitState::kOpen, "reaching the ratio opens");
+        ok &= Expect(IsCircuitOpen(breaker.Call(Ok)), "open circuit rejects with CircuitOpen");
+
+        CircuitBreaker few(TestOptions());
+        for (int i = 0; i < 9; ++i) (void)few.Call([&] { return Fail(eio); });
+        ok &= Expect(few.State() == CircuitState::kClosed, "fewer than min_calls stays closed");
+    }
+
+    {
+        // 打开 → 半开 → 关闭，半开时探测失败重新打开
+        CircuitBreaker breaker(TestOptions());
+        for (int i = 0; i < 10; ++i) (void)breaker.Call([&] { return Fail(eio); });
+        ok &= Expect(breaker.State() == CircuitState::kOpen, "all failures open");
+        WaitForHalfOpen();
+        (void)breaker.Call([&] { return Fail(eio); });
+        ok &= Expect(breaker.State() == CircuitState::kOpen, "failed probe reopens");
+        WaitForHalfOpen();
+        ok &= Expect(breaker.Call(Ok).OK(), "first probe passes");
+        ok &= Expect(breaker.State() == CircuitState::kHalfOpen, "half-open after one probe");
+        ok &= Expect(breaker.Call(Ok).OK(), "second probe passes");
+        ok &= Expect(breaker.State() == CircuitState::kClosed, "all probes succeed closes");
+    }
+
+    {
+        // 阈值大于 1 的错误码不打开断路器，探测时也算成功
+        CircuitBreaker breaker(TestOptions());
+        ok &= Expect(breaker.SetFailureRatio(ErrnoType(ENOENT), 2.0), "configure ENOENT");
+        for (int i = 0; i < 100; ++i) (void)breaker.Call([&] { return Fail(enoent); });
+        ok &= Expect(breaker.State() == CircuitState::kClosed, "ignored code does not trip");
+        for (int i = 0; i < 200; ++i) (void)breaker.Call([&] { return Fail(eio); });
+        ok &= Expect(breaker.State() == CircuitState::kOpen, "other code still trips");
+        WaitForHalfOpen();
+        (void)breaker.Call([&] { return Fail(enoent); });
+        (void)breaker.Call([&] { return Fail(enoent); });
+        ok &= Expect(breaker.State() == CircuitState::kClosed, "ignored code counts as probe success");
+    }
+
+    {
+        // EPERM 和 Cancelled 的原始错误码都是 1，但错误域不同
+        CircuitBreaker breaker(TestOptions());
+        ok &= Expect(breaker.SetFailureRatio(EPERM, 2.0), "configure EPERM");
+        for (int i = 0; i < 20; ++i) (void)breaker.Call([] { return Fail(GenericError(EPERM)); });
+        ok &= Expect(breaker.State() == CircuitState::kClosed, "EPERM is ignored");
+        for (int i = 0; i < 40; ++i)
+            (void)breaker.Call([] { return Fail(Cancelled(CancellationErrorCode::kCancelled)); });
+        ok &= Expect(breaker.State() == CircuitState::kOpen, "Cancelled with the same raw code trips");
+    }
+    return ok;
+}
+
+// 被包装的调用，只做一点计算，偶尔失败，失败比例远低于阈值
+Outcome Work(int i) {
+    if (i % 1000 == 999) return GenericError(EIO);
+    return i * 7;
+}
+
+template <typename Function>
+double NanosPerCall(int threads, int calls, Function function) {
+    std::atomic<long> sink{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            long local = 0;
+            for (int i = 0; i < calls; ++i) {
+                Outcome r = function(i);
+                if (r.OK()) local += r.Value();
+            }
+            sink.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(threads) * calls);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int calls = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    std::printf("calls=%d per thread hardware_concurrency=%u\n", calls, std::thread::hardware_concurrency());
+    if (!CheckBehavior()) return 1;
+
+    for (int threads = 1; threads <= 16; threads *= 4) {
+        const double direct = NanosPerCall(threads, calls, [](int i) { return Work(i); });
+        CircuitBreaker breaker;
+        const double wrapped =
+            NanosPerCall(threads, calls, [&](int i) { return breaker.Call([i] { return Work(i); }); });
+        if (breaker.State() != CircuitState::kClosed) {
+            std::fprintf(stderr, "breaker opened on a 0.1%% failure rate\n");
+            return 1;
+        }
+        std::printf("threads=%-3d direct %6.1f ns/call   CircuitBreaker %6.1f ns/call  (+%.1f ns)\n", threads,
+                    direct, wrapped, wrapped - direct);
+    }
+}
@@ -0,0 +1,228 @@
+// 深调用图压力测试生成器
+//
+// 单个 TRY 的微基准反映不出真实服务里 20~40 层调用栈上的错误传播代价。
+// 本程序生成一个由大量返回 Result 的函数组成的合成程序，按层组织：
+// 每层若干函数，每个函数静态地调用下一层 fanout 个函数中的一个（由参数决定），
+// 叶子按给定概率返回错误。所以一次根调用在运行时正好经过 depth 层。
+// 生成后会调用编译器编译并运行，报告编译时间、二进制大小和每帧传播开销。
+//
+// 用法：
+//   callgraph_gen [--functions N] [--depth D] [--fanout F] [--error-rate P]
+//                 [--iterations I] [--style result|errcode] [--inline]
+//                 [--include-dir DIR] [--out-dir DIR] [--cxx CXX] [--cxxflags FLAGS]
+//
+// --style errcode 生成等价的“返回错误码 + 输出参数”版本作为对照基线。
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sys/wait.h>
+
+namespace {
+
+struct Options {
+    int functions = 2000;
+    int depth = 30;
+    int fanout = 4;
+    double error_rate = 0.01;
+    long iterations = 1000000;
+    std::string style = "result";
+    bool allow_inline = false;
+    std::string include_dir = ".";
+    std::string out_dir = "callgraph_out";
+    std::string cxx = "g++";
+    std::string cxxflags = "-std=gnu++20 -O2";
+};
+
+void Usage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s [--functions N] [--depth D] [--fanout F] [--error-rate P]\n"
+        "          [--iterations I] [--style result|errcode] [--inline]\n"
+        "          [--include-dir DIR] [--out-dir DIR] [--cxx CXX] [--cxxflags FLAGS]\n",
+        argv0);
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--inline") {
+            options->allow_inline = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--functions") {
+            options->functions = std::atoi(value);
+        } else if (arg == "--depth") {
+            options->depth = std::atoi(value);
+        } else if (arg == "--fanout") {
+            options->fanout = std::atoi(value);
+        } else if (arg == "--error-rate") {
+            options->error_rate = std::atof(value);
+        } else if (arg == "--iterations") {
+            options->iterations = std::atol(value);
+        } else if (arg == "--style") {
+            options->style = value;
+        } else if (arg == "--include-dir") {
+            options->include_dir = value;
+        } else if (arg == "--out-dir") {
+            options->out_dir = value;
+        } else if (arg == "--cxx") {
+            options->cxx = value;
+        } else if (arg == "--cxxflags") {
+            options->cxxflags = value;
+        } else {
+            return false;
+        }
+    }
+    return options->depth >= 1 && options->fanout >= 1 &&
+           options->functions >= options->depth &&
+           (options->style == "result" || options->style == "errcode");
+}
+
+std::string FunctionName(int level, int index) {
+    return "f_" + std::to_string(level) + "_" + std::to_string(index);
+}
+
+// 生成源代码。每层 width 个函数，第 level 层第 i 个函数的第 k 个被调者是
+// 下一层的 (i * fanout + k) % width 号函数。
+std::string Generate(const Options& o) {
+    const bool result = o.style == "result";
+    const int width = o.functions / o.depth;
+    const unsigned threshold = static_cast<unsigned>(o.error_rate * 1000000);
+    const char* attr = o.allow_inline ? "" : "__attribute__((noinline)) ";
+
+    std::ostringstream out;
+    out << "// 由 callgraph_gen 生成，请勿手工修改\n";
+    if (result) out << "#include \"result.h\"\n";
+    out << "#include <chrono>\n#include <cstdio>\n#include <cstdlib>\n\n";
+    out << "static inline unsigned Next(unsigned x) { return x * 1103515245u + 12345u; }\n\n";
+
+    // 先声明，避免依赖定义顺序
+    for (int level = 0; level < o.depth; ++level) {
+        for (int i = 0; i < width; ++i) {
+            if (result)
+                out << "Result<int> " << FunctionName(level, i) << "(unsigned x);\n";
+            else
+                out << "int " << FunctionName(level, i) << "(unsigned x, int* out);\n";
+        }
+    }
+    out << "\n";
+
+    for (int level = 0; level < o.depth; ++level) {
+        const bool leaf = level == o.depth - 1;
+        for (int i = 0; i < width; ++i) {
+            const std::string name = FunctionName(level, i);
+            if (result)
+                out << attr << "Result<int> " << name << "(unsigned x) {\n";
+            else
+                out << attr << "int " << name << "(unsigned x, int* out) {\n";
+            if (leaf) {
+                out << "    if ((x >> 8) % 1000000u < " << threshold << "u) return "
+                    << (result ? "GenericError(" : "(") << (i % 255 + 1) << ");\n";
+                if (result)
+                    out << "    return static_cast<int>(x & 0xff);\n";
+                else
+                    out << "    *out = static_cast<int>(x & 0xff);\n    return 0;\n";
+                out << "}\n";
+                continue;
+            }
+            out << "    switch (x % " << o.fanout << "u) {\n";
+            for (int k = 0; k < o.fanout; ++k) {
+                const std::string callee = FunctionName(level + 1, (i * o.fanout + k) % width);
+                out << "    case " << k << ": {\n";
+                if (result) {
+                    out << "        auto&& v = TRY(" << callee << "(Next(x)));\n"
+                        << "        return v + 1;\n";
+                } else {
+                    out << "        int v;\n"
+                        << "        if (int rc = " << callee << "(Next(x), &v)) return rc;\n"
+                        << "        *out = v + 1;\n"
+                        << "        return 0;\n";
+                }
+                out << "    }\n";
+            }
+            out << "    }\n    __builtin_unreachable();\n}\n";
+        }
+    }
+
+    out << "\nint main(int argc, char** argv) {\n";
+    out << "    long iterations = argc > 1 ? std::atol(argv[1]) : " << o.iterations << ";\n";
+    if (result)
+        out << "    static Result<int> (*const roots[])(unsigned) = {\n";
+    else
+        out << "    static int (*const roots[])(unsigned, int*) = {\n";
+    for (int i = 0; i < width; ++i)
+        out << "        " << FunctionName(0, i) << ",\n";
+    out << "    };\n";
+    out << "    long sum = 0, errors = 0;\n";
+    out << "    auto start = std::chrono::steady_clock::now();\n";
+    out << "    for (long n = 0; n < iterations; ++n) {\n";
+    out << "        unsigned x = Next(static_cast<unsigned>(n));\n";
+    if (result) {
+        out << "        auto r = roots[n % " << width << "](x);\n"
+            << "        if (r.OK()) sum += r.Value(); else ++errors;\n";
+    } else {
+        out << "        int v;\n"
+            << "        if (roots[n % " << width << "](x, &v) == 0) sum += v; else ++errors;\n";
+    }
+    out << "    }\n";
+    out << "    double ns = std::chrono::duration<double, std::nano>(\n"
+        << "        std::chrono::steady_clock::now() - start).count();\n";
+    out << "    std::printf(\"%.3f %ld %ld\\n\", ns / iterations, errors, sum);\n";
+    out << "    return 0;\n}\n";
+    return out.str();
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!ParseOptions(argc, argv, &o)) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    namespace fs = std::filesystem;
+    fs::create_directories(o.out_dir);
+    const std::string source = o.out_dir + "/callgraph_" + o.style + ".cpp";
+    const std::string binary = o.out_dir + "/callgraph_" + o.style;
+    std::ofstream(source) << Generate(o);
+
+    const std::string compile = o.cxx + " " + o.cxxflags + " -I" + o.include_dir +
+                                " " + source + " -o " + binary;
+    auto start = std::chrono::steady_clock::now();
+    int status = std::system(compile.c_str());
+    double compile_seconds = SecondsSince(start);
+    if (status != 0) {
+        std::fprintf(stderr, "compile failed: %s\n", compile.c_str());
+        return 1;
+    }
+
+    FILE* run = popen((binary + " " + std::to_string(o.iterations)).c_str(), "r");
+    double ns_per_call = 0;
+    long errors = 0, checksum = 0;
+    if (run == nullptr || std::fscanf(run, "%lf %ld %ld", &ns_per_call, &errors, &checksum) != 3) {
+        std::fprintf(stderr, "failed to run %s\n", binary.c_str());
+        return 1;
+    }
+    pclose(run);
+
+    std::printf("style=%s functions=%d depth=%d fanout=%d error_rate=%g\n",
+                o.style.c_str(), o.depth * (o.functions / o.depth), o.depth, o.fanout,
+                o.error_rate);
+    std::printf("compile_seconds=%.2f binary_bytes=%ju\n",
+                compile_seconds, static_cast<uintmax_t>(fs::file_size(binary)));
+    std::printf("ns_per_call=%.2f ns_per_frame=%.3f errors=%ld/%ld checksum=%ld\n",
+                ns_per_call, ns_per_call / o.depth, errors, o.iterations, checksum);
+    return 0;
+}
@@ -0,0 +1,158 @@
+// 取消检查（cancellation.h）在没有取消时的开销
+//
+// 一个循环每次迭代做一点计算，分别不检查、用 TRY(token.Check()) 检查、在 CancellationScope 里
+// 用 TRY(CheckCancelled()) 检查，比较每次迭代的时间。计时之前先检查：默认构造的令牌永远不会取消、
+// 只有第一次 Cancel 返回 true、错误的位置是检查的地方、作用域嵌套后恢复外层的令牌、
+// 源销毁后令牌仍然有效，以及另一个线程发出的取消能让正在检查的循环停下来。
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "cancellation.h"
+
+namespace {
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+bool IsCancelledError(const Result<void, Cancelled>& r) {
+    return !r.OK() && r.Error().Code() == CancellationErrorCode::kCancelled;
+}
+
+// 迭代 n 次，每次都检查当前线程的令牌，取消后返回 Cancelled
+Result<uint64_t, Cancelled> CountUntilCancelled(uint64_t n) {
+    uint64_t i = 0;
+    for (; i < n; ++i) TRY(CheckCancelled());
+    return i;
+}
+
+bool CheckBehavior() {
+    bool ok = true;
+
+    CancellationToken never;
+    ok &= Expect(!never.IsCancelled() && never.Check().OK(), "default token is never cancelled");
+
+    CancellationSource source;
+    CancellationToken token = source.Token();
+    ok &= Expect(token.Check().OK(), "not cancelled yet");
+    ok &= Expect(source.Cancel(), "first Cancel reports it cancelled");
+    ok &= Expect(!source.Cancel(), "second Cancel does not");
+    const int line = __LINE__ + 1;
+    auto checked = token.Check();
+    ok &= Expect(IsCancelledError(checked) && checked.Error().Line() == line &&
+                     std::strstr(checked.Error().File(), "cancel_bench.cpp") != nullptr,
+                 "error points at the check");
+
+    // 嵌套的作用域，内层离开后恢复外层的令牌
+    CancellationSource outer, inner;
+    ok &= Expect(CheckCancelled().OK(), "no scope");
+    {
+        CancellationScope outer_scope(outer.Token());
+        {
+            CancellationScope inner_scope(inner.Token());
+            inner.Cancel();
+            ok &= Expect(IsCancelledError(CheckCancelled()), "inner token is current");
+        }
+        ok &= Expect(CheckCancelled().OK(), "outer token is restored");
+        outer.Cancel();
+        ok &= Expect(IsCancelledError(CheckCancelled()), "outer token is current");
+    }
+    ok &= Expect(CheckCancelled().OK(), "no scope after leaving");
+
+    // 源销毁后令牌仍然有效，保持最后的状态
+    CancellationToken orphan;
+    {
+        CancellationSource temporary;
+        orphan = temporary.Token();
+        temporary.Cancel();
+    }
+    ok &= Expect(orphan.IsCancelled(), "token outlives its source");
+
+    // 另一个线程取消，工作线程在下一次检查时停下
+    CancellationSource stop;
+    std::atomic<bool> started{false};
+    bool stopped = false;
+    std::thread worker([&] {
+        CancellationScope scope(stop.Token());
+        started.store(true);
+        auto counted = CountUntilCancelled(UINT64_MAX);
+        stopped = !counted.OK() && counted.Error().Code() == CancellationErrorCode::kCancelled;
+    });
+    while (!started.load()) std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stop.Cancel();
+    worker.join();
+    ok &= Expect(stopped, "cancel from another thread stops the loop");
+    return ok;
+}
+
+// 每次迭代的计算，防止循环被整个优化掉
+inline uint64_t Step(uint64_t x) {
+    return x * 0x9E3779B97F4A7C15ull + 1;
+}
+
+Result<uint64_t, Cancelled> Unchecked(uint64_t n) {
+    uint64_t x = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        x = Step(x);
+        asm volatile("" : "+r"(x));
+    }
+    return x;
+}
+
+Result<uint64_t, Cancelled> WithToken(const CancellationToken& token, uint64_t n) {
+    uint64_t x = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        TRY(token.Check());
+        x = Step(x);
+        asm volatile("" : "+r"(x));
+    }
+    return x;
+}
+
+Result<uint64_t, Cancelled> WithScope(uint64_t n) {
+    uint64_t x = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        TRY(CheckCancelled());
+        x = Step(x);
+        asm volatile("" : "+r"(x));
+    }
+    return x;
+}
+
+template <typename Function>
+double NanosPerIteration(uint64_t n, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    Result<uint64_t, Cancelled> r = function();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (!r.OK()) {
+        std::fprintf(stderr, "unexpected cancellation\n");
+        std::exit(1);
+    }
+    return elapsed.count() / n;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const uint64_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000000;
+    std::printf("iterations=%llu\n", static_cast<unsigned long long>(n));
+    if (!CheckBehavior()) return 1;
+
+    CancellationSource source;
+    const CancellationToken token = source.Token();
+    const double unchecked = NanosPerIteration(n, [&] { return Unchecked(n); });
+    const double with_token = NanosPerIteration(n, [&] { return WithToken(token, n); });
+    CancellationScope scope(token);
+    const double with_scope = NanosPerIteration(n, [&] { return WithScope(n); });
+    std::printf("  no check          %5.2f ns/iteration\n", unchecked);
+    std::printf("  token.Check()     %5.2f ns/iteration  (+%.2f)\n", with_token, with_token - unchecked);
+    std::printf("  CheckCancelled()  %5.2f ns/iteration  (+%.2f)\n", with_scope, with_scope - unchecked);
+}
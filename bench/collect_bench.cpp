@@ -0,0 +1,203 @@
+// Collect / CollectAllErrors（collect.h）和手写的循环对比
+//
+// 合并 n 个 Result<int> 和 Result<std::string>，输入分别是右值（移出值）和左值（拷贝）。
+// 计时之前先检查：遇到第一个错误就返回它、收集所有错误的顺序、右值输入移出值而左值输入不变、
+// 出错时不分配内存、全部成功时只分配一次，以及只能遍历一次的输入。
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include "collect.h"
+
+namespace {
+
+std::atomic<long> allocations{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+// 超出短字符串优化的长度，移动后源字符串一定是空的
+std::string LongString(int i) {
+    return std::string(32, 'a' + i % 26);
+}
+
+// codes[i] 为 0 时第 i 个结果是 i，否则是错误码为 codes[i] 的错误
+Result<int> Element(const std::vector<int>& codes, std::size_t i) {
+    if (codes[i] != 0) return GenericError(codes[i]);
+    return static_cast<int>(i);
+}
+
+std::vector<Result<int>> Elements(const std::vector<int>& codes) {
+    std::vector<Result<int>> results;
+    for (std::size_t i = 0; i < codes.size(); ++i) results.push_back(Element(codes, i));
+    return results;
+}
+
+// 只能遍历一次的输入，每次解引用生成一个新的 Result
+struct OnePass {
+    std::vector<int> codes;
+    std::size_t next = 0;
+
+    struct Iterator {
+        using difference_type = std::ptrdiff_t;
+        using value_type = Result<int>;
+        OnePass* owner;
+        Result<int> operator*() const {
+            return Element(owner->codes, owner->next);
+        }
+        Iterator& operator++() {
+            ++owner->next;
+            return *this;
+        }
+        void operator++(int) {
+            ++*this;
+        }
+        friend bool operator==(const Iterator& it, std::default_sentinel_t) {
+            return it.owner->next == it.owner->codes.size();
+        }
+    };
+
+    Iterator begin() {
+        return Iterator{this};
+    }
+    std::default_sentinel_t end() {
+        return {};
+    }
+};
+
+bool CheckBehavior() {
+    bool ok = true;
+
+    const std::vector<Result<int>> ints = Elements(std::vector<int>(10, 0));
+    auto all = Collect(ints);
+    ok &= Expect(all.OK() && all.Value().size() == 10 && all.Value()[9] == 9, "collect all values");
+    const std::vector<Result<int>> failed = Elements({0, 0, 0, 3, 0, 0, 0, 7, 0, 0});
+    auto first = Collect(failed);
+    ok &= Expect(!first.OK() && first.Error().Code() == 3, "first error is returned");
+    auto errors = CollectAllErrors(failed);
+    ok &= Expect(!errors.OK() && errors.Error().Size() == 2 && errors.Error().Errors()[0].Code() == 3 &&
+                     errors.Error().Errors()[1].Code() == 7,
+                 "all errors in order");
+
+    // 先检查一遍再分配：出错时不分配，成功时只给结果分配一次
+    long before = allocations.load();
+    (void)Collect(failed);
+    ok &= Expect(allocations.load() == before, "no allocation when an element failed");
+    before = allocations.load();
+    auto exact = Collect(ints);
+    ok &= Expect(allocations.load() == before + 1 && exact.Value().capacity() == 10, "one exact allocation");
+
+    std::vector<Result<std::string>> strings;
+    for (int i = 0; i < 4; ++i) strings.push_back(LongString(i));
+    auto copied = Collect(strings);
+    ok &= Expect(copied.OK() && strings[0].Value() == LongString(0), "lvalue input is copied");
+    const auto& const_strings = strings;
+    auto const_copied = Collect(std::move(const_strings));
+    ok &= Expect(const_copied.OK() && strings[1].Value() == LongString(1), "const rvalue input is copied");
+    auto moved = Collect(std::move(strings));
+    ok &= Expect(moved.OK() && moved.Value()[2] == LongString(2) && strings[2].Value().empty(),
+                 "rvalue input is moved from");
+
+    std::vector<Result<std::unique_ptr<int>>> pointers;
+    pointers.push_back(std::make_unique<int>(42));
+    auto unique = Collect(std::move(pointers));
+    ok &= Expect(unique.OK() && *unique.Value()[0] == 42, "move-only values");
+
+    OnePass good{{0, 0, 0}};
+    auto streamed = Collect(good);
+    ok &= Expect(streamed.OK() && streamed.Value().size() == 3 && streamed.Value()[2] == 2, "input range");
+    OnePass bad{{0, 5, 0, 6}};
+    auto streamed_errors = CollectAllErrors(bad);
+    ok &= Expect(!streamed_errors.OK() && streamed_errors.Error().Size() == 2 &&
+                     streamed_errors.Error().Errors()[1].Code() == 6,
+                 "input range errors");
+    return ok;
+}
+
+template <typename Function>
+double NanosPerElement(int n, int rounds, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) function();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(n) * rounds);
+}
+
+// 手写的版本：边检查边放进结果，不预先分配
+template <typename T>
+Result<std::vector<T>> CollectByHand(std::vector<Result<T>>&& results) {
+    std::vector<T> values;
+    for (auto& item : results) {
+        if (!item.OK()) return item.Error();
+        values.push_back(std::move(item.Value()));
+    }
+    return values;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int n = argc > 1 ? std::atoi(argv[1]) : 100000;
+    const int rounds = 20;
+    std::printf("elements=%d rounds=%d\n", n, rounds);
+    if (!CheckBehavior()) return 1;
+
+    std::size_t sink = 0;
+    auto ints = [&] {
+        std::vector<Result<int>> v;
+        v.reserve(n);
+        for (int i = 0; i < n; ++i) v.push_back(i);
+        return v;
+    };
+    auto strings = [&] {
+        std::vector<Result<std::string>> v;
+        v.reserve(n);
+        for (int i = 0; i < n; ++i) v.push_back(LongString(i));
+        return v;
+    };
+    const std::vector<Result<int>> int_input = ints();
+    const std::vector<Result<std::string>> string_input = strings();
+
+    // 右值输入需要每轮重新构造，构造的时间在两边都算进去
+    const double int_hand = NanosPerElement(n, rounds, [&] { sink += CollectByHand(ints()).Value().size(); });
+    const double int_move = NanosPerElement(n, rounds, [&] { sink += Collect(ints()).Value().size(); });
+    const double int_copy = NanosPerElement(n, rounds, [&] { sink += Collect(int_input).Value().size(); });
+    std::printf("  int     by hand %6.2f ns   Collect(rvalue) %6.2f ns   Collect(lvalue) %6.2f ns\n", int_hand,
+                int_move, int_copy);
+
+    const double string_hand = NanosPerElement(n, rounds, [&] { sink += CollectByHand(strings()).Value().size(); });
+    const double string_move = NanosPerElement(n, rounds, [&] { sink += Collect(strings()).Value().size(); });
+    const double string_copy = NanosPerElement(n, rounds, [&] { sink += Collect(string_input).Value().size(); });
+    std::printf("  string  by hand %6.2f ns   Collect(rvalue) %6.2f ns   Collect(lvalue) %6.2f ns\n", string_hand,
+                string_move, string_copy);
+    if (sink != static_cast<std::size_t>(n) * rounds * 6) {
+        std::fprintf(stderr, "wrong result size\n");
+        return 1;
+    }
+}
@@ -0,0 +1,74 @@
+// 比较 TRY 宏和 co_await 两种错误传播方式的开销
+//
+// 每种方式都测成功和失败两条路径，以及 1 层和 10 层嵌套调用。
+// 协程版本的代价主要在协程帧的分配上，帧缓存命中时和宏版本应在同一数量级。
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+
+#include "result_coro.h"
+
+namespace {
+
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+__attribute__((noinline)) Result<int> Leaf(int x) {
+    if (x < 0) return GenericError(EINVAL);
+    return x + 1;
+}
+
+template <int N>
+Result<int> MacroDepth(int x) {
+    if constexpr (N == 0) {
+        auto&& v = TRY(Leaf(x));
+        return v;
+    } else {
+        auto&& v = TRY(MacroDepth<N - 1>(x));
+        return v + 1;
+    }
+}
+
+template <int N>
+Result<int> CoroDepth(int x) {
+    if constexpr (N == 0) {
+        co_return co_await Leaf(x);
+    } else {
+        co_return co_await CoroDepth<N - 1>(x) + 1;
+    }
+}
+
+template <typename Function>
+double NanosecondsPerCall(Function function, int arg) {
+    constexpr int kIterations = 2000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        auto r = function(arg);
+        DoNotOptimize(r.OK());
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations;
+}
+
+template <int N>
+void Run() {
+    std::printf("depth=%-3d ok:    TRY %7.2f ns  co_await %7.2f ns\n", N + 1,
+                NanosecondsPerCall(MacroDepth<N>, 1), NanosecondsPerCall(CoroDepth<N>, 1));
+    std::printf("depth=%-3d error: TRY %7.2f ns  co_await %7.2f ns\n", N + 1,
+                NanosecondsPerCall(MacroDepth<N>, -1), NanosecondsPerCall(CoroDepth<N>, -1));
+}
+
+} // namespace
+
+int main() {
+    if (CoroDepth<9>(1).Value() != MacroDepth<9>(1).Value() ||
+        CoroDepth<9>(-1).Error().Code() != EINVAL) {
+        std::fprintf(stderr, "co_await and TRY disagree\n");
+        return 1;
+    }
+    Run<0>();
+    Run<9>();
+}
@@ -0,0 +1,143 @@
+// 不抛出异常的容器（fallible_containers.h）和标准容器的对比，用 -fno-exceptions 编译
+//
+// 测 Vector::TryPushBack 和 std::vector::push_back、String::TryAppend 和 std::string::append、
+// HashMap::TryEmplace 和 std::unordered_map::emplace。计时之前先检查分配失败和长度超出范围时
+// 返回的错误，以及失败后容器保持原样、追加自身元素等边界情况。
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fallible_containers.h"
+
+#if defined(__cpp_exceptions)
+#error "fallible_bench must be built with -fno-exceptions"
+#endif
+
+namespace {
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+template <typename R>
+bool Fails(const R& r, AllocErrorCode code) {
+    return !r.OK() && r.Error().Code() == code;
+}
+
+bool CheckBehavior() {
+    bool ok = true;
+
+    Vector<int> v;
+    for (int i = 0; i < 5; ++i) ok &= Expect(v.TryPushBack(i).OK(), "push back");
+    const int* data = v.Data();
+    const std::size_t capacity = v.Capacity();
+    // 超出地址空间的分配必然失败，容器保持原样
+    ok &= Expect(Fails(v.TryReserve(Vector<int>::MaxSize()), AllocErrorCode::kOutOfMemory), "huge reserve fails");
+    ok &= Expect(Fails(v.TryReserve(Vector<int>::MaxSize() + 1), AllocErrorCode::kLengthError),
+                 "reserve beyond MaxSize is a length error");
+    ok &= Expect(Fails(v.TryResize(Vector<int>::MaxSize()), AllocErrorCode::kOutOfMemory), "huge resize fails");
+    ok &= Expect(v.Size() == 5 && v.Data() == data && v.Capacity() == capacity && v[4] == 4,
+                 "failed operations leave the vector unchanged");
+
+    // 追加自身的元素，扩容时不能读已经释放的内存
+    while (v.Size() < v.Capacity()) ok &= Expect(v.TryPushBack(0).OK(), "fill");
+    ok &= Expect(v.TryPushBack(v[0]).OK() && v.Back() == 0, "push back own element while growing");
+    const std::size_t size = v.Size();
+    ok &= Expect(v.TryAppend(v.Data(), size).OK() && v.Size() == 2 * size && v[size + 1] == 1,
+                 "append own elements while growing");
+
+    auto clone = v.Clone();
+    ok &= Expect(clone.OK() && clone.Value().Size() == v.Size() && clone.Value()[1] == 1, "clone vector");
+
+    Vector<std::string> strings;
+    for (int i = 0; i < 100; ++i) ok &= Expect(strings.TryEmplaceBack(std::to_string(i)).OK(), "emplace string");
+    ok &= Expect(strings[99] == "99", "non-trivial elements survive relocation");
+
+    auto s = String::From("abc");
+    ok &= Expect(s.OK() && s.Value() == "abc" && s.Value().CStr()[3] == '\0', "string from");
+    String& str = s.Value();
+    for (int i = 0; i < 5; ++i) ok &= Expect(str.TryAppend(str.View()).OK(), "append self");
+    ok &= Expect(str.Size() == 3 * 32 && str.View().substr(93) == "abc" && str.CStr()[str.Size()] == '\0',
+                 "self append doubles and stays terminated");
+    ok &= Expect(Fails(str.TryReserve(Vector<char>::MaxSize()), AllocErrorCode::kLengthError),
+                 "string reserve beyond MaxSize is a length error");
+    str.Clear();
+    ok &= Expect(str.Empty() && str.CStr()[0] == '\0', "clear string");
+    ok &= Expect(String().CStr()[0] == '\0', "empty string has a terminator");
+
+    HashMap<std::string, int> map;
+    ok &= Expect(map.TryEmplace("a", 1).OK() && map.TryEmplace("b", 2).OK(), "emplace");
+    auto again = map.TryEmplace("a", 3);
+    ok &= Expect(again.OK() && !again.Value().second && *again.Value().first == 1, "existing key is not replaced");
+    ok &= Expect(Fails(map.TryReserve(SIZE_MAX), AllocErrorCode::kLengthError), "map reserve length error");
+    ok &= Expect(Fails(map.TryReserve(PTRDIFF_MAX / 256), AllocErrorCode::kOutOfMemory), "huge map reserve fails");
+    ok &= Expect(map.Size() == 2 && map.Find(std::string_view("b")).Value() == 2,
+                 "failed reserve leaves the map unchanged");
+    return ok;
+}
+
+template <typename Function>
+double NanosPerOp(int ops, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ops;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    std::printf("elements=%d\n", n);
+    if (!CheckBehavior()) return 1;
+
+    uint64_t sink = 0;
+    const double vector_std = NanosPerOp(n, [&] {
+        std::vector<int> v;
+        for (int i = 0; i < n; ++i) v.push_back(i);
+        sink += v.back();
+    });
+    const double vector_try = NanosPerOp(n, [&] {
+        Vector<int> v;
+        for (int i = 0; i < n; ++i) {
+            if (!v.TryPushBack(i).OK()) std::abort();
+        }
+        sink += v.Back();
+    });
+    std::printf("  push back  std::vector %6.2f ns   Vector %6.2f ns\n", vector_std, vector_try);
+
+    const double string_std = NanosPerOp(n, [&] {
+        std::string s;
+        for (int i = 0; i < n; ++i) s.append("abcdefgh", 1 + i % 8);
+        sink += s.size();
+    });
+    const double string_try = NanosPerOp(n, [&] {
+        String s;
+        for (int i = 0; i < n; ++i) {
+            if (!s.TryAppend(std::string_view("abcdefgh", 1 + i % 8)).OK()) std::abort();
+        }
+        sink += s.Size();
+    });
+    std::printf("  append     std::string %6.2f ns   String %6.2f ns\n", string_std, string_try);
+
+    const double map_std = NanosPerOp(n, [&] {
+        std::unordered_map<uint64_t, int> m;
+        for (int i = 0; i < n; ++i) m.emplace(uint64_t(i) * 0x9E3779B97F4A7C15ull, i);
+        sink += m.size();
+    });
+    const double map_try = NanosPerOp(n, [&] {
+        HashMap<uint64_t, int> m;
+        for (int i = 0; i < n; ++i) {
+            if (!m.TryEmplace(uint64_t(i) * 0x9E3779B97F4A7C15ull, i).OK()) std::abort();
+        }
+        sink += m.Size();
+    });
+    std::printf("  emplace    std::unordered_map %6.2f ns   HashMap %6.2f ns\n", map_std, map_try);
+    std::printf("(sink %llu)\n", static_cast<unsigned long long>(sink));
+}
@@ -0,0 +1,149 @@
+// File::Read（file.h）映射整个文件和用 read 分块读取的对比
+//
+// 在临时文件里写入 n MB 的文本，数其中的换行符：一边是 File::Read 加不同的 AccessPattern，
+// 一边是 read 到 1 MB 的缓冲区。文件刚写完，都在页缓存里，测的是映射和拷贝的开销。
+// 计时之前先检查：内容正确、重复调用返回同一个映射、移动 File 后返回的内容仍然有效、
+// 空文件、打开不存在的文件和映射目录时返回的 errno。
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "file.h"
+
+namespace {
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+bool WriteFile(const std::string& path, std::string_view content) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        std::perror(path.c_str());
+        return false;
+    }
+    const bool ok = std::fwrite(content.data(), 1, content.size(), f) == content.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+bool CheckBehavior(const std::string& dir) {
+    bool ok = true;
+    const std::string path = dir + "/check";
+    if (!WriteFile(path, "hello\nworld\n")) return false;
+
+    auto opened = OpenFile(path);
+    ok &= Expect(opened.OK(), "open");
+    if (!opened.OK()) return false;
+    File file = std::move(opened.Value());
+    ok &= Expect(file.Advise(AccessPattern::kRandom).OK(), "advise before mapping is a no-op");
+    auto first = file.Read();
+    auto second = file.Read(AccessPattern::kRandom);
+    ok &= Expect(first.OK() && first.Value() == "hello\nworld\n", "content");
+    ok &= Expect(second.OK() && second.Value().data() == first.Value().data(), "second read reuses the mapping");
+    for (AccessPattern pattern : {AccessPattern::kNormal, AccessPattern::kSequential, AccessPattern::kRandom,
+                                  AccessPattern::kWillNeed})
+        ok &= Expect(file.Advise(pattern).OK(), "advise");
+    File moved = std::move(file);
+    ok &= Expect(first.Value() == "hello\nworld\n" && moved.Read().Value().data() == first.Value().data(),
+                 "moving the File keeps the mapping");
+
+    const std::string empty_path = dir + "/empty";
+    if (!WriteFile(empty_path, "")) return false;
+    auto empty = OpenFile(empty_path);
+    ok &= Expect(empty.OK() && empty.Value().Read().OK() && empty.Value().Read().Value().empty(), "empty file");
+
+    auto missing = OpenFile(dir + "/missing");
+    ok &= Expect(!missing.OK() && missing.Error().Code() == ErrnoType(ENOENT), "missing file is ENOENT");
+
+    // 目录可以只读打开但不能映射；失败后没有留下映射，再次调用还是同样的错误
+    auto directory = OpenFile(dir);
+    ok &= Expect(directory.OK(), "open directory");
+    if (directory.OK()) {
+        auto mapped = directory.Value().Read();
+        ok &= Expect(!mapped.OK() && mapped.Error().Code() == ErrnoType(ENODEV), "mapping a directory is ENODEV");
+        auto again = directory.Value().Read();
+        ok &= Expect(!again.OK() && again.Error().Code() == ErrnoType(ENODEV), "failed read is not cached");
+    }
+    ::unlink(path.c_str());
+    ::unlink(empty_path.c_str());
+    return ok;
+}
+
+template <typename Function>
+double Millis(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    char dir_template[] = "/tmp/file_bench_XXXXXX";
+    if (::mkdtemp(dir_template) == nullptr) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string dir = dir_template;
+    const bool ok = CheckBehavior(dir);
+
+    // 每 64 字节一个换行
+    const std::string path = dir + "/data";
+    std::string content(megabytes << 20, 'x');
+    for (std::size_t i = 63; i < content.size(); i += 64) content[i] = '\n';
+    const std::size_t expected = content.size() / 64;
+    if (!WriteFile(path, content)) return 1;
+    content = std::string();
+    std::printf("size=%zu MB\n", megabytes);
+
+    std::size_t errors = 0;
+    const double by_read = Millis([&] {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        std::vector<char> buffer(1 << 20);
+        std::size_t lines = 0;
+        ssize_t n;
+        while ((n = ::read(fd, buffer.data(), buffer.size())) > 0)
+            lines += std::count(buffer.data(), buffer.data() + n, '\n');
+        ::close(fd);
+        if (n < 0 || lines != expected) ++errors;
+    });
+    std::printf("  read 1 MB chunks     %7.1f ms\n", by_read);
+
+    const std::pair<AccessPattern, const char*> patterns[] = {{AccessPattern::kNormal, "kNormal"},
+                                                              {AccessPattern::kSequential, "kSequential"},
+                                                              {AccessPattern::kWillNeed, "kWillNeed"}};
+    for (const auto& [pattern, name] : patterns) {
+        const double mapped = Millis([&] {
+            auto file = OpenFile(path);
+            if (!file.OK()) {
+                ++errors;
+                return;
+            }
+            auto text = file.Value().Read(pattern);
+            if (!text.OK() || std::count(text.Value().begin(), text.Value().end(), '\n') !=
+                                  static_cast<std::ptrdiff_t>(expected))
+                ++errors;
+        });
+        std::printf("  File::Read %-11s %7.1f ms  (%.2fx)\n", name, mapped, by_read / mapped);
+    }
+
+    ::unlink(path.c_str());
+    ::rmdir(dir.c_str());
+    if (!ok || errors != 0) {
+        std::fprintf(stderr, "File checks failed (%zu wrong results)\n", errors);
+        return 1;
+    }
+}
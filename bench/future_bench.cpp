@@ -0,0 +1,64 @@
+// 比较 Promise/Future 和 std::promise/std::future 在线程间传递 Result 的延迟
+//
+// 两个线程乒乓：主线程设置第 i 个 ping，等待第 i 个 pong；对方线程等待 ping，
+// 再设置 pong。报告单程的平均延迟，即往返时间的一半。
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "future.h"
+
+namespace {
+
+template <typename PromiseType, typename FutureType, typename Set, typename Get>
+double HandoffNanoseconds(int rounds, Set set, Get get) {
+    std::vector<PromiseType> ping(rounds), pong(rounds);
+    std::vector<FutureType> ping_futures, pong_futures;
+    for (int i = 0; i < rounds; ++i) {
+        ping_futures.push_back(ping[i].get_future());
+        pong_futures.push_back(pong[i].get_future());
+    }
+
+    std::thread peer([&] {
+        for (int i = 0; i < rounds; ++i) {
+            Result<int> r = get(ping_futures[i]);
+            set(pong[i], r.Value() + 1);
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    long sum = 0;
+    for (int i = 0; i < rounds; ++i) {
+        set(ping[i], i);
+        sum += get(pong_futures[i]).Value();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    peer.join();
+    if (sum != static_cast<long>(rounds) * (rounds + 1) / 2) std::abort();
+    return elapsed.count() / rounds / 2;
+}
+
+// 让 Promise/Future 的接口和标准库的对上
+struct StdStylePromise : Promise<int> {
+    Future<int> get_future() { return GetFuture(); }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int rounds = argc > 1 ? std::atoi(argv[1]) : 100000;
+    double ours = HandoffNanoseconds<StdStylePromise, Future<int>>(
+        rounds,
+        [](StdStylePromise& p, int v) { p.SetValue(v); },
+        [](Future<int>& f) { return std::move(f).Get(); });
+    double standard = HandoffNanoseconds<std::promise<Result<int>>, std::future<Result<int>>>(
+        rounds,
+        [](std::promise<Result<int>>& p, int v) { p.set_value(v); },
+        [](std::future<Result<int>>& f) { return f.get(); });
+    std::printf("rounds=%d hardware_concurrency=%u\n", rounds, std::thread::hardware_concurrency());
+    std::printf("Promise/Future:           %8.1f ns per handoff\n", ours);
+    std::printf("std::promise/std::future: %8.1f ns per handoff\n", standard);
+}
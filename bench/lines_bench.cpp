@@ -0,0 +1,115 @@
+// ParseIntegerLines（parse_lines.h）按线程数的扩展
+//
+// 输入是每行一个随机整数的文本，线程数从 1 开始翻倍到 hardware_concurrency。计时之前先检查
+// 行尾和进制的处理、报告的错误的字节偏移和行列号，以及在很小的块大小下结果和逐行顺序解析一致、
+// 多个块出错时总是报告整个文本中的第一个错误。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "parse_lines.h"
+
+namespace {
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+bool FailsAt(const Result<std::vector<int64_t>, TextParseError>& r, ParseErrorCode code, std::size_t offset,
+             std::size_t line, std::size_t column) {
+    return !r.OK() && r.Error().Code() == code && r.Error().ByteOffset() == offset &&
+           r.Error().LineNumber() == line && r.Error().Column() == column;
+}
+
+std::string RandomLines(std::mt19937_64& rng, std::size_t lines, std::vector<int64_t>* values) {
+    std::string text;
+    for (std::size_t i = 0; i < lines; ++i) {
+        const int64_t v = static_cast<int64_t>(rng()) >> (rng() % 63);
+        if (values) values->push_back(v);
+        text += std::to_string(v);
+        text += '\n';
+    }
+    return text;
+}
+
+bool CheckBehavior(ThreadPool& pool) {
+    bool ok = true;
+
+    auto crlf = ParseIntegerLines<int64_t>(pool, "1\r\n-2\r\n3");
+    ok &= Expect(crlf.OK() && crlf.Value() == std::vector<int64_t>{1, -2, 3}, "CRLF and no final newline");
+    auto hex = ParseIntegerLines<int64_t>(pool, "ff\n10\n", 16);
+    ok &= Expect(hex.OK() && hex.Value() == std::vector<int64_t>{255, 16}, "base 16");
+    auto empty = ParseIntegerLines<int64_t>(pool, "");
+    ok &= Expect(empty.OK() && empty.Value().empty(), "empty text");
+
+    ok &= Expect(FailsAt(ParseIntegerLines<int64_t>(pool, "1\n2\n12x\n4\n"), ParseErrorCode::kInvalid, 6, 3, 3),
+                 "bad character position");
+    ok &= Expect(FailsAt(ParseIntegerLines<int64_t>(pool, "1\n\n3\n"), ParseErrorCode::kInvalid, 2, 2, 1),
+                 "empty line in the middle");
+    ok &= Expect(FailsAt(ParseIntegerLines<int64_t>(pool, "7\n99999999999999999999\n"), ParseErrorCode::kOutOfRange,
+                         2, 2, 1),
+                 "out of range");
+
+    // 很小的块，每块只有几行，结果要和顺序解析一致
+    std::mt19937_64 rng(42);
+    std::vector<int64_t> expected;
+    const std::string text = RandomLines(rng, 5000, &expected);
+    for (std::size_t chunk_size : {1, 7, 64, 4096}) {
+        auto values = ParseIntegerLines<int64_t>(pool, text, 10, chunk_size);
+        ok &= Expect(values.OK() && values.Value() == expected, "small chunks match the sequential parse");
+    }
+
+    // 在后面的行里放几个错误，报告的总是第一个，和块的划分无关
+    std::string bad = text;
+    std::size_t line = 1, first_offset = 0, first_line = 0;
+    for (std::size_t pos = 0, n = 0; pos < bad.size(); pos = bad.find('\n', pos) + 1, ++line) {
+        if (line % 1000 != 777) continue;
+        bad[pos] = '#';
+        if (n++ == 0) {
+            first_offset = pos;
+            first_line = line;
+        }
+    }
+    for (std::size_t chunk_size : {1, 100, 100000})
+        ok &= Expect(FailsAt(ParseIntegerLines<int64_t>(pool, bad, 10, chunk_size), ParseErrorCode::kInvalid,
+                             first_offset, first_line, 1),
+                     "first error in the text is reported");
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::mt19937_64 rng(1);
+    const std::string text = RandomLines(rng, lines, nullptr);
+    std::printf("lines=%zu bytes=%zu hardware_concurrency=%d\n", lines, text.size(), max_threads);
+
+    {
+        ThreadPool pool(4);
+        if (!CheckBehavior(pool)) return 1;
+    }
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool pool(threads);
+        auto start = std::chrono::steady_clock::now();
+        auto values = ParseIntegerLines<int64_t>(pool, text);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (!values.OK() || values.Value().size() != lines) {
+            std::fprintf(stderr, "parse failed\n");
+            return 1;
+        }
+        std::printf("threads=%-3d %7.1f ms  %6.2f ns/line  %6.0f MB/s\n", threads, elapsed.count() * 1e3,
+                    elapsed.count() * 1e9 / lines, text.size() / elapsed.count() / 1e6);
+    }
+}
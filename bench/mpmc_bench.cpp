@@ -0,0 +1,125 @@
+// MpmcQueue 在不同生产者/消费者数量下的吞吐量
+//
+// 每个生产者推入固定数量的 Result<int>，其中一部分是错误。队列满时记一次
+// 反压并让出 CPU 后重试。单个操作和批量操作各测一遍。
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "mpmc_queue.h"
+
+namespace {
+
+constexpr std::size_t kBatch = 32;
+
+Result<int> MakeItem(int i) {
+    if (i % 64 == 0) return GenericError(EINVAL);
+    return i;
+}
+
+struct Stats {
+    double seconds;
+    long rejected;
+};
+
+Stats Run(int producers, int consumers, int per_producer, bool batch) {
+    MpmcQueue<int> queue(1024);
+    const long total = static_cast<long>(producers) * per_producer;
+    std::atomic<long> consumed{0};
+    std::atomic<long> rejected{0};
+    std::atomic<long> sum{0};
+    std::atomic<long> errors{0};
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            long local_rejected = 0;
+            if (batch) {
+                std::vector<Result<int>> items;
+                for (int i = 0; i < per_producer;) {
+                    items.clear();
+                    for (std::size_t k = 0; k < kBatch && i + static_cast<int>(k) < per_producer; ++k)
+                        items.push_back(MakeItem(i + k));
+                    std::size_t done = 0;
+                    while (done < items.size()) {
+                        auto r = queue.TryPushBatch(items.data() + done, items.size() - done);
+                        if (r.OK()) {
+                            done += r.Value();
+                        } else {
+                            ++local_rejected;
+                            std::this_thread::yield();
+                        }
+                    }
+                    i += items.size();
+                }
+            } else {
+                for (int i = 0; i < per_producer; ++i) {
+                    while (!queue.TryPush(MakeItem(i)).OK()) {
+                        ++local_rejected;
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            rejected.fetch_add(local_rejected, std::memory_order_relaxed);
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            long local_sum = 0, local_errors = 0;
+            auto consume = [&](Result<int>&& item) {
+                if (item.OK())
+                    local_sum += item.Value();
+                else
+                    ++local_errors;
+            };
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                std::size_t n = 0;
+                if (batch) {
+                    n = queue.TryPopBatch(kBatch, consume);
+                } else if (auto item = queue.TryPop()) {
+                    consume(std::move(*item));
+                    n = 1;
+                }
+                if (n == 0)
+                    std::this_thread::yield();
+                else
+                    consumed.fetch_add(n, std::memory_order_relaxed);
+            }
+            sum.fetch_add(local_sum);
+            errors.fetch_add(local_errors);
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    long expected_errors = static_cast<long>(producers) * ((per_producer + 63) / 64);
+    if (errors.load() != expected_errors) {
+        std::fprintf(stderr, "lost items: errors=%ld expected=%ld\n", errors.load(), expected_errors);
+        std::abort();
+    }
+    return {elapsed.count(), rejected.load()};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int per_producer = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    const int configs[][2] = {{1, 1}, {1, 4}, {4, 1}, {2, 2}, {4, 4}, {8, 8}};
+    std::printf("items per producer=%d capacity=1024 hardware_concurrency=%u\n",
+                per_producer, std::thread::hardware_concurrency());
+    for (bool batch : {false, true}) {
+        for (auto& config : configs) {
+            Stats stats = Run(config[0], config[1], per_producer, batch);
+            double items = static_cast<double>(config[0]) * per_producer;
+            std::printf("%-6s P=%d C=%d  %8.2f Mitems/s  rejected pushes=%ld\n",
+                        batch ? "batch" : "single", config[0], config[1],
+                        items / stats.seconds / 1e6, stats.rejected);
+        }
+    }
+}
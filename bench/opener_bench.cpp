@@ -0,0 +1,155 @@
+// FileOpener（file_opener.h）打开文件的开销，和直接用完整路径 open 对比
+//
+// 在临时目录下建若干个子目录，每个子目录里一些文件，分别测存在的文件和不存在的文件（负缓存）。
+// 计时之前先检查缓存的行为：负缓存命中和 TTL 过期、目录里新建文件时负缓存失效、
+// 目录被移走后不再使用旧的 fd，以及同一个目录的不同写法。
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_opener.h"
+
+namespace {
+
+constexpr int kDirectories = 8;
+constexpr int kFilesPerDirectory = 64;
+
+void MustSucceed(int rc, const char* what) {
+    if (rc != 0) {
+        std::perror(what);
+        std::exit(1);
+    }
+}
+
+void WriteFile(const std::string& path, const char* content) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        std::perror(path.c_str());
+        std::exit(1);
+    }
+    std::fputs(content, f);
+    std::fclose(f);
+}
+
+std::string ReadAll(File& file) {
+    char buffer[64];
+    ssize_t n = ::pread(file.Fd(), buffer, sizeof(buffer), 0);
+    return n > 0 ? std::string(buffer, n) : std::string();
+}
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+bool IsMissing(const Result<File, ErrnoError>& r) {
+    return !r.OK() && r.Error().Code() == ErrnoType(ENOENT);
+}
+
+bool CheckBehavior(const std::string& root) {
+    bool ok = true;
+    FileOpenerOptions options;
+    options.negative_ttl = std::chrono::milliseconds(50);
+    FileOpener opener(options);
+
+    // 悬空的符号链接打开时是 ENOENT；目标出现在另一个目录里，被监视的目录收不到事件，
+    // 只能等负缓存过期
+    const std::string dir = root + "/check";
+    MustSucceed(::mkdir(dir.c_str(), 0755), "mkdir");
+    MustSucceed(::mkdir((root + "/elsewhere").c_str(), 0755), "mkdir");
+    MustSucceed(::symlink((root + "/elsewhere/target").c_str(), (dir + "/link").c_str()), "symlink");
+    ok &= Expect(IsMissing(opener.Open(dir + "/link")), "dangling link is missing");
+    WriteFile(root + "/elsewhere/target", "target");
+    ok &= Expect(IsMissing(opener.Open(dir + "/link")), "negative cache hit");
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    ok &= Expect(opener.Open(dir + "/link").OK(), "negative cache expires after the TTL");
+
+    // 在被监视的目录里新建文件，负缓存立即失效
+    ok &= Expect(IsMissing(opener.Open(dir + "/created")), "file is missing before creation");
+    WriteFile(dir + "/created", "created");
+    ok &= Expect(opener.Open(dir + "/created").OK(), "IN_CREATE invalidates the negative entry");
+
+    // 同一个目录的几种写法共用一个 fd；目录被移走后重新打开同名的新目录
+    WriteFile(dir + "/x", "old");
+    auto a = opener.Open(dir + "/x");
+    auto b = opener.Open(dir + "/./x");
+    ok &= Expect(a.OK() && b.OK(), "open through two spellings");
+    MustSucceed(::rename(dir.c_str(), (dir + ".old").c_str()), "rename");
+    MustSucceed(::mkdir(dir.c_str(), 0755), "mkdir");
+    WriteFile(dir + "/x", "new");
+    for (const char* name : {"/x", "/./x"}) {
+        auto file = opener.Open(dir + name);
+        ok &= Expect(file.OK() && ReadAll(file.Value()) == "new", "moved directory is evicted");
+    }
+
+    // 相对路径不经过缓存
+    ok &= Expect(IsMissing(opener.Open("opener_bench_no_such_file")), "relative missing path");
+    return ok;
+}
+
+template <typename Function>
+double NanosPerOp(int ops, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; ++i) function(i);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ops;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int ops = argc > 1 ? std::atoi(argv[1]) : 200000;
+    char root_template[] = "/tmp/opener_bench_XXXXXX";
+    if (::mkdtemp(root_template) == nullptr) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string root = root_template;
+    std::printf("opens=%d directories=%d files=%d\n", ops, kDirectories, kDirectories * kFilesPerDirectory);
+
+    const bool ok = CheckBehavior(root);
+
+    std::vector<std::string> present, missing;
+    for (int d = 0; d < kDirectories; ++d) {
+        const std::string dir = root + "/data" + std::to_string(d) + "/sub";
+        MustSucceed(::mkdir((root + "/data" + std::to_string(d)).c_str(), 0755), "mkdir");
+        MustSucceed(::mkdir(dir.c_str(), 0755), "mkdir");
+        for (int f = 0; f < kFilesPerDirectory; ++f) {
+            present.push_back(dir + "/file" + std::to_string(f));
+            missing.push_back(dir + "/none" + std::to_string(f));
+            WriteFile(present.back(), "x");
+        }
+    }
+
+    FileOpener opener;
+    std::size_t errors = 0;
+    for (const auto* paths : {&present, &missing}) {
+        const bool exists = paths == &present;
+        const double direct = NanosPerOp(ops, [&](int i) {
+            int fd = ::open((*paths)[i % paths->size()].c_str(), O_RDONLY | O_CLOEXEC);
+            if ((fd >= 0) != exists) ++errors;
+            if (fd >= 0) ::close(fd);
+        });
+        const double cached = NanosPerOp(ops, [&](int i) {
+            if (opener.Open((*paths)[i % paths->size()]).OK() != exists) ++errors;
+        });
+        std::printf("  %-8s open %7.0f ns   FileOpener %7.0f ns  (%.2fx)\n", exists ? "present" : "missing",
+                    direct, cached, direct / cached);
+    }
+
+    std::filesystem::remove_all(root);
+    if (!ok || errors != 0) {
+        std::fprintf(stderr, "FileOpener checks failed (%zu wrong results)\n", errors);
+        return 1;
+    }
+}
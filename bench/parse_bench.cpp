@@ -0,0 +1,132 @@
+// 批量解析整数（parse_int_batch.h）、基于 from_chars 的 ParseInt（parse.h）
+// 和 result.cpp 里基于 strtol 的 ParseInt 的对比
+//
+// 输入是随机长度的十进制整数，夹杂一定比例的非法和溢出的字符串。先核对批量解析的
+// 结果和 strtol 版本完全一致，再分别计时。parse.h 里的 ParseInt 只接受十进制，
+// 对 " 12"、"0x1f" 这类输入的结果和 strtol 不同，所以只计时。
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse.h"
+#include "parse_int_batch.h"
+
+namespace {
+
+// 和 result.cpp 里的 ParseInt 相同，只是错误类型换成了 GenericError
+Result<int> StrtolParseInt(const std::string& s) {
+    errno = 0;
+    char* end = const_cast<char*>(s.c_str());
+    long n = strtol(s.c_str(), &end, 0);
+    if (errno == 0) {
+        if (*end != '\0') {
+            errno = EINVAL;
+        } else if (n > INT_MAX || n < INT_MIN) {
+            errno = ERANGE;
+        } else {
+            return static_cast<int>(n);
+        }
+    }
+    return GenericError(errno);
+}
+
+std::vector<std::string> MakeInputs(std::size_t n, double error_rate) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int> digits(1, 10);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    const char* specials[] = {"", "0", "-0", "+7", " 12", "12 ", "0x1f", "010", "09",
+                              "abc", "-", "2147483648", "-2147483648", "99999999999"};
+    std::vector<std::string> inputs;
+    inputs.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (uniform(rng) < error_rate) {
+            inputs.push_back(specials[rng() % (sizeof(specials) / sizeof(specials[0]))]);
+            continue;
+        }
+        std::string s = rng() % 4 == 0 ? "-" : "";
+        int len = digits(rng);
+        s += static_cast<char>('1' + rng() % 9);
+        for (int k = 1; k < len; ++k) s += static_cast<char>('0' + rng() % 10);
+        inputs.push_back(std::move(s));
+    }
+    return inputs;
+}
+
+const char* IsaName(ParseIntIsa isa) {
+    switch (isa) {
+    case ParseIntIsa::kScalar: return "scalar";
+    case ParseIntIsa::kSse42: return "sse4.2";
+    case ParseIntIsa::kAvx2: return "avx2";
+    }
+    return "?";
+}
+
+template <typename Function>
+double NsPerItem(std::size_t n, int rounds, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) function();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds / n;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t n = argc > 1 ? std::atol(argv[1]) : 1000000;
+    const int rounds = 5;
+    std::vector<ParseIntIsa> isas = {ParseIntIsa::kScalar};
+    if (BestParseIntIsa() != ParseIntIsa::kScalar) isas.push_back(ParseIntIsa::kSse42);
+    if (BestParseIntIsa() == ParseIntIsa::kAvx2) isas.push_back(ParseIntIsa::kAvx2);
+
+    for (double error_rate : {0.0, 0.01, 0.1}) {
+        std::vector<std::string> inputs = MakeInputs(n, error_rate);
+        std::vector<std::string_view> views(inputs.begin(), inputs.end());
+        std::vector<int> values(n), errors(n);
+
+        for (ParseIntIsa isa : isas) {
+            ParseIntLanes(views, values.data(), errors.data(), isa);
+            for (std::size_t i = 0; i < n; ++i) {
+                auto expected = StrtolParseInt(inputs[i]);
+                int code = expected.OK() ? 0 : expected.Error().Code();
+                int value = expected.OK() ? expected.Value() : 0;
+                if (errors[i] != code || values[i] != value) {
+                    std::fprintf(stderr, "%s mismatch on \"%s\": got %d/%d, want %d/%d\n", IsaName(isa),
+                                 inputs[i].c_str(), values[i], errors[i], value, code);
+                    return 1;
+                }
+            }
+        }
+
+        std::printf("items=%zu error_rate=%.2f\n", n, error_rate);
+        long sink = 0;
+        double strtol_ns = NsPerItem(n, rounds, [&] {
+            for (auto& s : inputs) sink += StrtolParseInt(s).ValueOr(0);
+        });
+        std::printf("  %-16s %6.2f ns/item\n", "strtol ParseInt", strtol_ns);
+        double from_chars_ns = NsPerItem(n, rounds, [&] {
+            for (auto s : views) sink += ParseInt(s).ValueOr(0);
+        });
+        std::printf("  %-16s %6.2f ns/item  (%.1fx)\n", "from_chars", from_chars_ns,
+                    strtol_ns / from_chars_ns);
+        for (ParseIntIsa isa : isas) {
+            double ns = NsPerItem(n, rounds, [&] {
+                ParseIntLanes(views, values.data(), errors.data(), isa);
+                sink += values[n / 2];
+            });
+            std::printf("  lanes %-10s %6.2f ns/item  (%.1fx)\n", IsaName(isa), ns, strtol_ns / ns);
+        }
+        double batch_ns = NsPerItem(n, rounds, [&] {
+            ResultBatch<int> batch = ParseIntBatch(views);
+            sink += batch.ErrorCount();
+        });
+        std::printf("  %-16s %6.2f ns/item  (%.1fx)\n", "ParseIntBatch", batch_ns, strtol_ns / batch_ns);
+        if (sink == 42) std::printf("\n");
+    }
+}
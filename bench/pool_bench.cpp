@@ -0,0 +1,122 @@
+// ObjectPool（object_pool.h）在不同线程数下借出和归还的吞吐量
+//
+// 每个线程反复 Acquire、使用、归还，池的容量小于最大的线程数，高并发时会出现耗尽，
+// 耗尽的次数单独统计。每个对象带一个占用标志，借出时检查没有被两个线程同时借到。
+// 对比的是 mutex 保护的空闲列表，以及不用线程缓存、只用全局无锁栈的 ObjectPool。
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "object_pool.h"
+
+namespace {
+
+struct Connection {
+    std::atomic<int> owner{0};
+    long uses = 0;
+};
+
+void Use(Connection& connection) {
+    if (connection.owner.exchange(1, std::memory_order_relaxed) != 0) {
+        std::fprintf(stderr, "object handed out twice\n");
+        std::abort();
+    }
+    ++connection.uses;
+    connection.owner.store(0, std::memory_order_relaxed);
+}
+
+// 用 mutex 保护空闲列表的对照组
+class MutexPool {
+public:
+    explicit MutexPool(std::size_t capacity) : objects_(capacity) {
+        for (std::size_t i = 0; i < capacity; ++i) free_.push_back(i);
+    }
+
+    Result<Connection*, PoolError> Acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) return PoolError(PoolErrorCode::kExhausted);
+        Connection* connection = &objects_[free_.back()];
+        free_.pop_back();
+        return connection;
+    }
+
+    void Release(Connection* connection) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(connection - objects_.data());
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Connection> objects_;
+    std::vector<std::size_t> free_;
+};
+
+struct Stats {
+    double seconds;
+    long exhausted;
+};
+
+template <typename Body>
+Stats Run(int threads, long per_thread, Body body) {
+    std::atomic<long> exhausted{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            long local = 0;
+            for (long i = 0; i < per_thread; ++i) local += body();
+            exhausted.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return {elapsed.count(), exhausted.load()};
+}
+
+void Print(const char* name, int threads, long ops, Stats stats) {
+    std::printf("  %-22s threads=%-3d %8.2f Mops/s  exhausted=%ld\n", name, threads, ops / stats.seconds / 1e6,
+                stats.exhausted);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const long ops = argc > 1 ? std::atol(argv[1]) : 4000000;
+    const std::size_t capacity = 32;
+    std::printf("ops=%ld capacity=%zu hardware_concurrency=%u\n", ops, capacity, std::thread::hardware_concurrency());
+
+    for (int threads : {1, 4, 16, 64}) {
+        const long per_thread = ops / threads;
+        const long total = per_thread * threads;
+
+        MutexPool mutex_pool(capacity);
+        Print("mutex free list", threads, total, Run(threads, per_thread, [&] {
+                  auto connection = mutex_pool.Acquire();
+                  if (!connection.OK()) return 1;
+                  Use(*connection.Value());
+                  mutex_pool.Release(connection.Value());
+                  return 0;
+              }));
+
+        ObjectPoolOptions global_only;
+        global_only.cache_size = 0;
+        for (auto options : {global_only, ObjectPoolOptions{}}) {
+            ObjectPool<Connection> pool(options, capacity);
+            Print(options.cache_size == 0 ? "ObjectPool global" : "ObjectPool cached", threads, total,
+                  Run(threads, per_thread, [&] {
+                      auto connection = pool.Acquire();
+                      if (!connection.OK()) return 1;
+                      Use(*connection.Value());
+                      return 0;
+                  }));
+        }
+    }
+}
@@ -0,0 +1,150 @@
+// LineReader（line_reader.h）逐行读取文件，和 std::getline 对比
+//
+// 在临时文件里写入随机长度的行，分别用 LineReader 和 std::ifstream + std::getline 读一遍，
+// 核对行数和总长度。计时之前先检查：跨越多次 read 的行、比初始缓冲区长的行、空行和
+// 没有 '\n' 的最后一行，以及 read 失败（EAGAIN）之后再次调用 Next 可以继续读。
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "line_reader.h"
+
+namespace {
+
+bool Expect(bool ok, const char* what) {
+    if (!ok) std::fprintf(stderr, "check failed: %s\n", what);
+    return ok;
+}
+
+bool NextIs(LineReader& reader, std::string_view expected) {
+    auto line = reader.Next();
+    return line && line->OK() && line->Value() == expected;
+}
+
+bool CheckBehavior() {
+    bool ok = true;
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        std::perror("pipe");
+        return false;
+    }
+
+    // 写入端每次只写几个字节，行跨越多次 read；最长的一行远超初始的 16 字节
+    const std::string long_line(1000, 'x');
+    const std::string input = "a\n\nbc\n" + long_line + "\nlast";
+    std::thread writer([&] {
+        for (std::size_t pos = 0; pos < input.size(); pos += 3) {
+            (void)!::write(fds[1], input.data() + pos, std::min<std::size_t>(3, input.size() - pos));
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        }
+        ::close(fds[1]);
+    });
+    LineReader reader(fds[0], 16);
+    ok &= Expect(NextIs(reader, "a"), "first line");
+    ok &= Expect(NextIs(reader, ""), "empty line");
+    ok &= Expect(NextIs(reader, "bc"), "line across reads");
+    ok &= Expect(NextIs(reader, long_line), "line longer than the buffer");
+    ok &= Expect(reader.Capacity() >= long_line.size(), "buffer grows to the longest line");
+    ok &= Expect(NextIs(reader, "last"), "last line without a newline");
+    ok &= Expect(!reader.Next(), "end of input");
+    ok &= Expect(!reader.Next(), "end of input is sticky");
+    writer.join();
+    ::close(fds[0]);
+
+    // 非阻塞的管道没有数据时 read 返回 EAGAIN，之后可以重试
+    if (::pipe2(fds, O_NONBLOCK) != 0) {
+        std::perror("pipe2");
+        return false;
+    }
+    LineReader retry(fds[0]);
+    (void)!::write(fds[1], "par", 3);
+    auto failed = retry.Next();
+    ok &= Expect(failed && !failed->OK() && failed->Error().Code() == ErrnoType(EAGAIN), "read error is returned");
+    (void)!::write(fds[1], "tial\nnext\n", 10);
+    ok &= Expect(NextIs(retry, "partial"), "retry after the error keeps the partial line");
+    ok &= Expect(NextIs(retry, "next"), "retry continues");
+    ::close(fds[1]);
+    ok &= Expect(!retry.Next(), "end after retry");
+    ::close(fds[0]);
+    return ok;
+}
+
+template <typename Function>
+double Seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    if (!CheckBehavior()) return 1;
+
+    char path[] = "/tmp/reader_bench_XXXXXX";
+    const int fd = ::mkstemp(path);
+    if (fd < 0) {
+        std::perror("mkstemp");
+        return 1;
+    }
+    std::size_t bytes = 0;
+    {
+        std::mt19937_64 rng(1);
+        std::ofstream out(path);
+        for (std::size_t i = 0; i < lines; ++i) {
+            const std::string line(rng() % 120, 'a' + i % 26);
+            out << line << '\n';
+            bytes += line.size();
+        }
+    }
+    std::printf("lines=%zu bytes=%zu\n", lines, bytes + lines);
+
+    std::size_t reader_lines = 0, reader_bytes = 0;
+    bool read_failed = false;
+    const double reader_seconds = Seconds([&] {
+        LineReader reader(fd);
+        while (auto line = reader.Next()) {
+            if (!line->OK()) {
+                read_failed = true;
+                break;
+            }
+            ++reader_lines;
+            reader_bytes += line->Value().size();
+        }
+    });
+
+    std::size_t getline_lines = 0, getline_bytes = 0;
+    const double getline_seconds = Seconds([&] {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            ++getline_lines;
+            getline_bytes += line.size();
+        }
+    });
+    ::close(fd);
+    ::unlink(path);
+
+    std::printf("  std::getline %7.1f ms  %6.2f ns/line\n", getline_seconds * 1e3, getline_seconds * 1e9 / lines);
+    std::printf("  LineReader   %7.1f ms  %6.2f ns/line  (%.2fx)\n", reader_seconds * 1e3,
+                reader_seconds * 1e9 / lines, getline_seconds / reader_seconds);
+    if (read_failed || reader_lines != lines || reader_bytes != bytes || getline_lines != lines ||
+        getline_bytes != bytes) {
+        std::fprintf(stderr, "line counts do not match\n");
+        return 1;
+    }
+}
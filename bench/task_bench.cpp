@@ -0,0 +1,111 @@
+// Task + 工作窃取线程池的扩展性测试
+//
+// 模拟大量并发的 GetIntFromFile：每个任务在线程池里先“读文件”（一段计算），
+// 再等待一个解析子任务，部分输入是非法的，错误通过 co_await 传播回来。
+// 根任务在一个工作线程里派生全部子任务，其他线程只能靠窃取拿到任务。
+// 开始计时之前先检查 WhenAll/WhenAny 在调用者从外部取消时以 Cancelled 结束。
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <latch>
+#include <string>
+#include <vector>
+
+#include "task.h"
+#include "thread_pool.h"
+#include "when_all.h"
+
+namespace {
+
+Result<int> ParseInt(const std::string& s) {
+    char* end = nullptr;
+    long n = std::strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end != '\0') return GenericError(EINVAL);
+    return static_cast<int>(n);
+}
+
+Task<int> ParseTask(std::string s) {
+    co_return co_await ParseInt(s);
+}
+
+Task<int> GetIntTask(int i, int work) {
+    // 模拟读文件的开销
+    unsigned h = i;
+    for (int k = 0; k < work; ++k) h = h * 2654435761u + k;
+    std::string content = (i % 100 == 0) ? "bad" : std::to_string(h % 1000);
+    co_return co_await ParseTask(std::move(content)) + 1;
+}
+
+Task<void> Root(ThreadPool& pool, int count, int work, std::latch& done,
+                std::atomic<long>& sum, std::atomic<int>& errors) {
+    co_await pool.Schedule();
+    for (int i = 0; i < count; ++i) {
+        Spawn(pool, GetIntTask(i, work), [&](Result<int> r) {
+            if (r.OK())
+                sum.fetch_add(r.Value(), std::memory_order_relaxed);
+            else
+                errors.fetch_add(1, std::memory_order_relaxed);
+            done.count_down();
+        });
+    }
+}
+
+Task<int> ValueTask(int i) {
+    co_return i;
+}
+
+std::vector<Task<int>> ValueTasks(int n) {
+    std::vector<Task<int>> tasks;
+    for (int i = 0; i < n; ++i) tasks.push_back(ValueTask(i));
+    return tasks;
+}
+
+// 已经取消的 source 使所有子任务都被跳过
+bool CheckExternalCancel(ThreadPool& pool) {
+    CancellationSource source;
+    source.Cancel();
+    auto all = SyncWait(WhenAll(pool, ValueTasks(3), source));
+    auto any = SyncWait(WhenAny(pool, ValueTasks(3), source));
+    return !all.OK() && all.Error().Code() == int(CancellationErrorCode::kCancelled) &&
+           !any.OK() && any.Error().Code() == int(CancellationErrorCode::kCancelled);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int count = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const int work = argc > 2 ? std::atoi(argv[2]) : 200;
+    std::printf("tasks=%d work=%d hardware_concurrency=%u\n", count, work,
+                std::thread::hardware_concurrency());
+
+    {
+        ThreadPool pool(2);
+        if (!CheckExternalCancel(pool)) {
+            std::fprintf(stderr, "WhenAll/WhenAny ignored external cancellation\n");
+            return 1;
+        }
+    }
+
+    long expected_sum = -1;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        ThreadPool pool(threads);
+        std::latch done(count);
+        std::atomic<long> sum{0};
+        std::atomic<int> errors{0};
+        auto start = std::chrono::steady_clock::now();
+        auto root = SyncWait(Root(pool, count, work, done, sum, errors));
+        done.wait();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (!root.OK() || (expected_sum >= 0 && sum.load() != expected_sum) ||
+            errors.load() != (count + 99) / 100) {
+            std::fprintf(stderr, "wrong result with %d threads\n", threads);
+            return 1;
+        }
+        expected_sum = sum.load();
+        std::printf("threads=%-3d %8.3f s  %10.0f tasks/s\n", threads, elapsed.count(),
+                    count / elapsed.count());
+    }
+}
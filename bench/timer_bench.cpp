@@ -0,0 +1,170 @@
+// TimerWheel（timer_wheel.h）在 1 万到 100 万个定时器下的放入、取消和到期的开销，
+// 和按时间排序的 std::multimap 对比；以及 TimerService 加 WithDeadline（deadline.h）
+// 给大量 Future 设置超时的端到端耗时。
+//
+// 时间轮部分用模拟的时钟推进，到期时检查每个定时器都在它的截止时间所在的刻度内触发，
+// 被取消的一个都没有触发。
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "deadline.h"
+#include "timer_wheel.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+constexpr auto kTick = milliseconds(1);
+
+struct Timer {
+    Clock::time_point deadline;
+    bool cancelled = false;
+    bool fired = false;
+};
+
+Clock::time_point simulated_now;
+std::size_t late = 0;
+
+void OnTimer(void* context, bool fire) {
+    if (!fire) return;
+    auto* timer = static_cast<Timer*>(context);
+    if (timer->fired || timer->cancelled || simulated_now < timer->deadline ||
+        simulated_now >= timer->deadline + kTick)
+        ++late;
+    timer->fired = true;
+}
+
+double NsPerOp(Clock::time_point start, std::size_t ops) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+// 截止时间均匀分布在 [1ms, span) 内，取消一半，然后以 1ms 的步长推进到全部到期
+void RunWheel(std::size_t n, milliseconds span) {
+    const Clock::time_point origin{};
+    std::mt19937_64 rng(n);
+    std::vector<Timer> timers(n);
+    for (auto& timer : timers) timer.deadline = origin + milliseconds(1 + rng() % (span.count() - 1));
+
+    TimerWheel wheel(kTick, origin);
+    std::vector<TimerId> ids(n);
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) ids[i] = wheel.Schedule(timers[i].deadline, OnTimer, &timers[i]);
+    const double schedule_ns = NsPerOp(start, n);
+
+    start = Clock::now();
+    for (std::size_t i = 0; i < n; i += 2) {
+        timers[i].cancelled = wheel.Cancel(ids[i]);
+        if (!timers[i].cancelled) std::abort();
+    }
+    const double cancel_ns = NsPerOp(start, (n + 1) / 2);
+
+    late = 0;
+    std::size_t fired = 0;
+    start = Clock::now();
+    for (simulated_now = origin; simulated_now <= origin + span; simulated_now += kTick)
+        fired += wheel.Advance(simulated_now);
+    const double expire_ns = NsPerOp(start, fired);
+
+    if (fired != n / 2 || late != 0 || wheel.Size() != 0) {
+        std::fprintf(stderr, "wheel n=%zu: fired=%zu late=%zu left=%zu\n", n, fired, late, wheel.Size());
+        std::exit(1);
+    }
+    std::printf("  %-10s n=%-8zu schedule %6.1f ns  cancel %6.1f ns  expire %6.1f ns\n", "TimerWheel", n,
+                schedule_ns, cancel_ns, expire_ns);
+}
+
+// 对照组：按截止时间排序的 multimap，取消用保存的迭代器
+void RunMultimap(std::size_t n, milliseconds span) {
+    const Clock::time_point origin{};
+    std::mt19937_64 rng(n);
+    std::vector<Timer> timers(n);
+    for (auto& timer : timers) timer.deadline = origin + milliseconds(1 + rng() % (span.count() - 1));
+
+    std::multimap<Clock::time_point, Timer*> queue;
+    std::vector<std::multimap<Clock::time_point, Timer*>::iterator> ids(n);
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < n; ++i) ids[i] = queue.emplace(timers[i].deadline, &timers[i]);
+    const double schedule_ns = NsPerOp(start, n);
+
+    start = Clock::now();
+    for (std::size_t i = 0; i < n; i += 2) {
+        queue.erase(ids[i]);
+        timers[i].cancelled = true;
+    }
+    const double cancel_ns = NsPerOp(start, (n + 1) / 2);
+
+    late = 0;
+    std::size_t fired = 0;
+    start = Clock::now();
+    for (simulated_now = origin; simulated_now <= origin + span; simulated_now += kTick) {
+        while (!queue.empty() && queue.begin()->first <= simulated_now) {
+            OnTimer(queue.begin()->second, true);
+            queue.erase(queue.begin());
+            ++fired;
+        }
+    }
+    const double expire_ns = NsPerOp(start, fired);
+    if (fired != n / 2 || late != 0) std::abort();
+    std::printf("  %-10s n=%-8zu schedule %6.1f ns  cancel %6.1f ns  expire %6.1f ns\n", "multimap", n,
+                schedule_ns, cancel_ns, expire_ns);
+}
+
+// n 个 Future 加上 timeout 的超时，一半在超时前完成，另一半以 DeadlineExceeded 结束
+void RunService(std::size_t n, milliseconds timeout) {
+    TimerService service;
+    std::vector<Promise<int>> promises(n);
+    std::atomic<std::size_t> values{0}, deadlines{0}, others{0};
+
+    auto start = Clock::now();
+    for (auto& promise : promises) {
+        WithDeadline(service, promise.GetFuture(), timeout).Then([&](Result<int>&& r) {
+            if (r.OK())
+                values.fetch_add(1, std::memory_order_relaxed);
+            else if (r.Error().Code() == static_cast<int>(DeadlineErrorCode::kDeadlineExceeded))
+                deadlines.fetch_add(1, std::memory_order_relaxed);
+            else
+                others.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    const double arm_ns = NsPerOp(start, n);
+
+    start = Clock::now();
+    for (std::size_t i = 0; i < n; i += 2) promises[i].SetValue(static_cast<int>(i));
+    const double complete_ns = NsPerOp(start, (n + 1) / 2);
+
+    while (values + deadlines + others < n) std::this_thread::sleep_for(milliseconds(1));
+    std::chrono::duration<double, std::milli> total = Clock::now() - start;
+    // 没有完成的 Promise 析构时会设置 EPIPE，但 Future 已经超时，这个结果被丢弃
+    promises.clear();
+
+    if (values != (n + 1) / 2 || deadlines != n / 2 || others != 0) {
+        std::fprintf(stderr, "service n=%zu: values=%zu deadlines=%zu others=%zu\n", n, values.load(),
+                     deadlines.load(), others.load());
+        std::exit(1);
+    }
+    std::printf("  %-10s n=%-8zu arm %6.1f ns  complete %6.1f ns  all done after %.1f ms (timeout %lld ms)\n",
+                "Service", n, arm_ns, complete_ns, total.count(), static_cast<long long>(timeout.count()));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t max = argc > 1 ? std::atol(argv[1]) : 1000000;
+    const milliseconds span(60000);
+    std::printf("deadlines spread over %lld ms, tick 1 ms, half of the timers cancelled\n",
+                static_cast<long long>(span.count()));
+    for (std::size_t n = 10000; n <= max; n *= 10) {
+        RunWheel(n, span);
+        RunMultimap(n, span);
+    }
+    // 超时要比放入全部定时器的时间长，否则先放入的在完成前就超时了
+    for (std::size_t n = 10000; n <= max; n *= 10) RunService(n, milliseconds(100 + n / 500));
+}
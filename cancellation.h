@@ -0,0 +1,109 @@
+#ifndef ERROR_HANDLING_CANCELLATION_H_
+#define ERROR_HANDLING_CANCELLATION_H_
+
+// 协作式取消。CancellationSource 发出取消信号，持有 CancellationToken 的
+// 一方在合适的时候检查，检查只是一次原子读。
+//
+// 返回 Result 的函数可以在传播错误的地方顺便检查，取消后以 Cancelled 错误返回：
+//
+//   Result<int> Work(const CancellationToken& token) {
+//       TRY(token.Check());           // 没有取消时只多了一次原子读
+//       ...
+//   }
+//
+// 不方便一层层传递令牌时，可以用 CancellationScope 把令牌设为当前线程的令牌，
+// 深处的代码用 TRY(CheckCancelled()) 检查。
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "result.h"
+
+enum class CancellationErrorCode {
+    kCancelled = 1,
+};
+
+using Cancelled = TypedError<CancellationErrorCode>;
+
+class CancellationToken {
+public:
+    // 默认构造的令牌永远不会被取消
+    CancellationToken() {}
+
+    bool IsCancelled() const {
+        return flag_ && flag_->load(std::memory_order_acquire);
+    }
+
+    // 已经取消时返回 Cancelled 错误，错误的位置是检查的地方
+    Result<void, Cancelled> Check(const char* file = __builtin_FILE(), int line = __builtin_LINE(),
+                                  const char* function = __builtin_FUNCTION()) const {
+        if (IsCancelled()) return Cancelled(CancellationErrorCode::kCancelled, file, line, function);
+        return {};
+    }
+
+private:
+    friend class CancellationSource;
+    friend class CancellationScope;
+    explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> flag)
+        : flag_(std::move(flag)) {}
+
+    std::shared_ptr<const std::atomic<bool>> flag_;
+};
+
+class CancellationSource {
+public:
+    CancellationSource() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    CancellationToken Token() const {
+        return CancellationToken(flag_);
+    }
+
+    // 返回是否是本次调用发出的取消
+    bool Cancel() {
+        return !flag_->exchange(true, std::memory_order_acq_rel);
+    }
+
+    bool IsCancelled() const {
+        return flag_->load(std::memory_order_acquire);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+// 在作用域内把 token 设为当前线程的令牌，可以嵌套，离开作用域时恢复外层的令牌。
+// 令牌是线程局部的，协程在 co_await 之后可能换了线程，要在恢复后重新设置。
+class CancellationScope {
+public:
+    explicit CancellationScope(const CancellationToken& token)
+        : token_(token), previous_(std::exchange(Current(), token_.flag_.get())) {}
+
+    CancellationScope(const CancellationScope&) = delete;
+    CancellationScope& operator=(const CancellationScope&) = delete;
+
+    ~CancellationScope() {
+        Current() = previous_;
+    }
+
+    // 当前线程的令牌的标志，没有时为空
+    static const std::atomic<bool>*& Current() {
+        static thread_local const std::atomic<bool>* current = nullptr;
+        return current;
+    }
+
+private:
+    CancellationToken token_;  // 保持标志在作用域内有效
+    const std::atomic<bool>* previous_;
+};
+
+// 检查当前线程的令牌，用法：TRY(CheckCancelled());
+inline Result<void, Cancelled> CheckCancelled(const char* file = __builtin_FILE(), int line = __builtin_LINE(),
+                                              const char* function = __builtin_FUNCTION()) {
+    const std::atomic<bool>* flag = CancellationScope::Current();
+    if (flag != nullptr && flag->load(std::memory_order_acquire))
+        return Cancelled(CancellationErrorCode::kCancelled, file, line, function);
+    return {};
+}
+
+#endif // ERROR_HANDLING_CANCELLATION_H_
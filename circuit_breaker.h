@@ -0,0 +1,282 @@
+#ifndef ERROR_HANDLING_CIRCUIT_BREAKER_H_
+#define ERROR_HANDLING_CIRCUIT_BREAKER_H_
+
+// 断路器：依赖出故障时在本地快速失败，不用每次都等到超时：
+//
+//   CircuitBreaker breaker;                          // 每个依赖一个
+//   breaker.SetFailureRatio(ErrnoType(ENOENT), 2.0); // 不存在不算依赖的故障，返回是否设置成功
+//   Result<Response, GenericError> r = breaker.Call([&] { return client.Get(key); });
+//
+// 断路器统计最近一段时间（滑动窗口）里的调用，失败按错误域和错误码分别计数。错误域是构造错误时
+// 错误码的类型（BaseError::Domain），TypedError 转成 GenericError 后仍然保留，直接用 int 构造的
+// GenericError 属于 int 这个错误域。某一种错误占调用总数的比例达到它的阈值时断路器打开，
+// 之后的调用直接返回 CircuitOpen 错误，不再调用依赖。打开一段时间后进入半开状态，放行少量的
+// 探测调用，探测全部成功就关闭，有一个失败就重新打开；阈值大于 1 的错误码在探测时也不算失败。
+// 返回的错误类型要能容纳 CircuitOpen，通常用 GenericError。
+//
+// 状态、打开的截止时间和半开时的探测计数打包在一个原子变量里，所有的状态转换都是 CAS。
+// 关闭状态下放行调用只读一次这个变量；记录结果是对当前时间片计数器的原子加。
+// 滑动窗口由若干个时间片组成，时间片过期时由第一个碰到它的线程清零，清零前后
+// 其他线程的少量计数可能丢失，统计是近似的。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "result.h"
+
+enum class CircuitErrorCode {
+    kCircuitOpen = 1,
+};
+
+using CircuitOpen = TypedError<CircuitErrorCode>;
+
+enum class CircuitState {
+    kClosed,
+    kOpen,
+    kHalfOpen,
+};
+
+struct CircuitBreakerOptions {
+    std::chrono::steady_clock::duration window = std::chrono::seconds(10);  // 统计的时间窗口
+    std::size_t buckets = 10;          // 窗口分成的时间片个数
+    uint32_t min_calls = 20;           // 窗口内调用少于这个数时不打开
+    double failure_ratio = 0.5;        // 错误码默认的失败比例阈值
+    std::chrono::steady_clock::duration open_duration = std::chrono::seconds(5);  // 打开多久后开始探测
+    uint32_t half_open_probes = 3;     // 半开时放行的探测调用个数
+};
+
+namespace circuit_breaker_internal {
+
+inline uint64_t ErrorKey(int domain, int code) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(domain)) << 32 | static_cast<uint32_t>(code);
+}
+
+inline int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace circuit_breaker_internal
+
+class CircuitBreaker {
+public:
+    explicit CircuitBreaker(CircuitBreakerOptions options = {})
+        : bucket_count_(std::max<std::size_t>(options.buckets, 1)),
+          bucket_nanos_(std::max<int64_t>(ToNanos(options.window) / static_cast<int64_t>(bucket_count_), 1)),
+          min_calls_(options.min_calls),
+          open_nanos_(ToNanos(options.open_duration)),
+          half_open_probes_(std::max<uint32_t>(options.half_open_probes, 1)),
+          buckets_(new Bucket[bucket_count_]) {
+        for (auto& ratio : ratios_) ratio.store(ToPpm(options.failure_ratio), std::memory_order_relaxed);
+    }
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    // 单独设置某个错误码的失败比例阈值，大于 1 表示这个错误码不会使断路器打开，应该在使用前设置。
+    // 单独设置的错误码最多 kMaxConfiguredKeys 个，超过时返回 false，这个错误码仍按默认阈值统计。
+    template <typename Code>
+    bool SetFailureRatio(Code code, double ratio) {
+        const uint64_t key = circuit_breaker_internal::ErrorKey(ErrorDomain<Code>(), static_cast<int>(code));
+        const std::size_t slot = Slot(key, 0, kMaxConfiguredKeys);
+        if (slot == kMaxKeys) return false;
+        ratios_[slot].store(ToPpm(ratio), std::memory_order_relaxed);
+        return true;
+    }
+
+    CircuitState State() const {
+        return static_cast<CircuitState>(state_.load(std::memory_order_acquire) & kStateMask);
+    }
+
+    // 断路器放行时调用 function()，否则直接返回 CircuitOpen 错误
+    template <typename Function>
+    std::invoke_result_t<Function&> Call(Function&& function) {
+        using ResultType = std::invoke_result_t<Function&>;
+        using ErrorType = typename ResultTraits<ResultType>::Error;
+        static_assert(std::is_constructible_v<ErrorType, CircuitOpen>,
+                      "the error type must be able to hold CircuitOpen");
+        const Admission admission = Admit();
+        if (admission == Admission::kRejected) return ErrorType(OpenError());
+        ResultType result = function();
+        if (result.OK()) {
+            if (admission == Admission::kProbe)
+                OnProbeResult(true);
+            else
+                CurrentBucket(circuit_breaker_internal::NowNanos()).calls.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            const ErrorType& error = result.Error();
+            const uint64_t key = circuit_breaker_internal::ErrorKey(error.Domain(), static_cast<int>(error.Code()));
+            if (admission == Admission::kProbe)
+                OnProbeResult(!CanTrip(key));
+            else
+                OnFailure(key);
+        }
+        return result;
+    }
+
+    // 前 kMaxConfiguredKeys 个计数槽留给 SetFailureRatio，其余的分给最先失败的错误码
+    static constexpr std::size_t kMaxConfiguredKeys = 4;
+    static constexpr std::size_t kMaxKeys = 11;
+
+private:
+    enum class Admission {
+        kRejected,
+        kPass,
+        kProbe,
+    };
+
+    // state_ 的布局：低 2 位是 CircuitState；打开时其余的位是探测开始的时间（纳秒）；
+    // 半开时 2~31 位是已放行的探测数，32~63 位是已成功的探测数。关闭时整个值为 0。
+    static constexpr uint64_t kStateMask = 3;
+    static constexpr uint64_t kProbeAdmitted = uint64_t(1) << 2;
+    static constexpr uint64_t kProbeSucceeded = uint64_t(1) << 32;
+    static constexpr uint32_t kNeverTrip = 1000000;  // 比例 1，超过它的阈值永远达不到
+
+    struct alignas(64) Bucket {
+        std::atomic<int64_t> epoch{-1};  // 时间片的序号，-1 表示无效
+        std::atomic<uint32_t> calls{0};
+        std::atomic<uint32_t> failures[kMaxKeys + 1] = {};  // 最后一个是其余的错误码
+    };
+
+    template <typename Duration>
+    static int64_t ToNanos(Duration duration) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+
+    static uint32_t ToPpm(double ratio) {
+        return static_cast<uint32_t>(std::clamp(ratio, 0.0, 2.0) * 1000000);
+    }
+
+    static uint64_t OpenState(int64_t until) {
+        return static_cast<uint64_t>(until) << 2 | static_cast<uint64_t>(CircuitState::kOpen);
+    }
+
+    // 打开是常见的情况，共用一个错误对象，不用每次分配
+    static const CircuitOpen& OpenError() {
+        static const CircuitOpen error(CircuitErrorCode::kCircuitOpen);
+        return error;
+    }
+
+    Admission Admit() {
+        uint64_t state = state_.load(std::memory_order_acquire);
+        if (state == 0) return Admission::kPass;
+        return AdmitSlow(state);
+    }
+
+    Admission AdmitSlow(uint64_t state) {
+        for (;;) {
+            switch (static_cast<CircuitState>(state & kStateMask)) {
+                case CircuitState::kClosed:
+                    return Admission::kPass;
+                case CircuitState::kOpen: {
+                    const int64_t until = static_cast<int64_t>(state >> 2);
+                    if (circuit_breaker_internal::NowNanos() < until) return Admission::kRejected;
+                    const uint64_t probing = kProbeAdmitted | static_cast<uint64_t>(CircuitState::kHalfOpen);
+                    if (state_.compare_exchange_weak(state, probing, std::memory_order_acq_rel,
+                                                     std::memory_order_acquire))
+                        return Admission::kProbe;
+                    break;
+                }
+                case CircuitState::kHalfOpen:
+                    if ((state & (kProbeSucceeded - 1)) >> 2 >= half_open_probes_) return Admission::kRejected;
+                    if (state_.compare_exchange_weak(state, state + kProbeAdmitted, std::memory_order_acq_rel,
+                                                     std::memory_order_acquire))
+                        return Admission::kProbe;
+                    break;
+            }
+        }
+    }
+
+    // 阈值大于 1 的错误码不算依赖的故障，探测时也当作成功
+    bool CanTrip(uint64_t key) {
+        return ratios_[Slot(key, kMaxConfiguredKeys, kMaxKeys)].load(std::memory_order_relaxed) <= kNeverTrip;
+    }
+
+    // 探测失败重新打开；全部成功则关闭并清空窗口
+    void OnProbeResult(bool ok) {
+        uint64_t state = state_.load(std::memory_order_acquire);
+        while ((state & kStateMask) == static_cast<uint64_t>(CircuitState::kHalfOpen)) {
+            uint64_t next;
+            if (!ok) {
+                next = OpenState(circuit_breaker_internal::NowNanos() + open_nanos_);
+            } else if ((state >> 32) + 1 >= half_open_probes_) {
+                next = 0;
+            } else {
+                next = state + kProbeSucceeded;
+            }
+            if (state_.compare_exchange_weak(state, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                if (next == 0) ResetWindow();
+                return;
+            }
+        }
+    }
+
+    void OnFailure(uint64_t key) {
+        const int64_t now = circuit_breaker_internal::NowNanos();
+        const std::size_t slot = Slot(key, kMaxConfiguredKeys, kMaxKeys);
+        Bucket& bucket = CurrentBucket(now);
+        bucket.calls.fetch_add(1, std::memory_order_relaxed);
+        bucket.failures[slot].fetch_add(1, std::memory_order_relaxed);
+
+        const int64_t epoch = now / bucket_nanos_;
+        uint64_t calls = 0, failures = 0;
+        for (std::size_t i = 0; i < bucket_count_; ++i) {
+            const Bucket& b = buckets_[i];
+            const int64_t e = b.epoch.load(std::memory_order_acquire);
+            if (e < 0 || e > epoch || epoch - e >= static_cast<int64_t>(bucket_count_)) continue;
+            calls += b.calls.load(std::memory_order_relaxed);
+            failures += b.failures[slot].load(std::memory_order_relaxed);
+        }
+        if (calls < min_calls_) return;
+        if (failures * 1000000 < calls * ratios_[slot].load(std::memory_order_relaxed)) return;
+        uint64_t closed = 0;
+        state_.compare_exchange_strong(closed, OpenState(now + open_nanos_), std::memory_order_acq_rel);
+    }
+
+    // 错误码对应的计数槽。还没有时在 [begin, end) 里占一个空位，没有空位时返回 kMaxKeys
+    std::size_t Slot(uint64_t key, std::size_t begin, std::size_t end) {
+        for (std::size_t i = 0; i < kMaxKeys; ++i) {
+            if (keys_[i].load(std::memory_order_acquire) == key) return i;
+        }
+        for (std::size_t i = begin; i < end; ++i) {
+            uint64_t k = keys_[i].load(std::memory_order_acquire);
+            if (k == 0 && keys_[i].compare_exchange_strong(k, key, std::memory_order_acq_rel)) return i;
+            if (k == key) return i;
+        }
+        return kMaxKeys;
+    }
+
+    Bucket& CurrentBucket(int64_t now) {
+        const int64_t epoch = now / bucket_nanos_;
+        Bucket& bucket = buckets_[static_cast<std::size_t>(epoch) % bucket_count_];
+        int64_t e = bucket.epoch.load(std::memory_order_acquire);
+        if (e < epoch && bucket.epoch.compare_exchange_strong(e, epoch, std::memory_order_acq_rel)) {
+            bucket.calls.store(0, std::memory_order_relaxed);
+            for (auto& failures : bucket.failures) failures.store(0, std::memory_order_relaxed);
+        }
+        return bucket;
+    }
+
+    void ResetWindow() {
+        for (std::size_t i = 0; i < bucket_count_; ++i) buckets_[i].epoch.store(-1, std::memory_order_release);
+    }
+
+    const std::size_t bucket_count_;
+    const int64_t bucket_nanos_;
+    const uint32_t min_calls_;
+    const int64_t open_nanos_;
+    const uint32_t half_open_probes_;
+    std::unique_ptr<Bucket[]> buckets_;
+    std::atomic<uint64_t> keys_[kMaxKeys] = {};  // 0 表示空位
+    std::atomic<uint32_t> ratios_[kMaxKeys + 1];  // 失败比例阈值，单位百万分之一
+    alignas(64) std::atomic<uint64_t> state_{0};
+};
+
+#endif // ERROR_HANDLING_CIRCUIT_BREAKER_H_
@@ -0,0 +1,111 @@
+#ifndef ERROR_HANDLING_COLLECT_H_
+#define ERROR_HANDLING_COLLECT_H_
+
+// 把一组 Result<T, E> 合并成一个结果：
+//
+//   std::vector<Result<int>> results = ...;
+//   Result<std::vector<int>> all = Collect(std::move(results));       // 遇到第一个错误就停止
+//   Result<std::vector<int>, ErrorList<GenericError>> checked =
+//       CollectAllErrors(std::move(results));                         // 收集所有的错误
+//
+// 输入是右值时把值移出来，否则拷贝。能多次遍历的输入会先检查一遍有没有错误，
+// 出错时不分配内存；全部成功时按确切的个数只分配一次。
+
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "result.h"
+
+// 多个错误的集合，可以作为 Result 的错误类型，为空表示没有错误
+template <typename ErrorType>
+class ErrorList {
+public:
+    ErrorList() {}
+
+    explicit operator bool() const {
+        return !errors_.empty();
+    }
+    bool operator!() const {
+        return errors_.empty();
+    }
+
+    void Add(ErrorType error) {
+        errors_.push_back(std::move(error));
+    }
+
+    const std::vector<ErrorType>& Errors() const {
+        return errors_;
+    }
+    std::size_t Size() const {
+        return errors_.size();
+    }
+
+private:
+    std::vector<ErrorType> errors_;
+};
+
+template <typename Range>
+struct CollectTraits {
+    using ItemResult = std::remove_cvref_t<std::ranges::range_reference_t<Range>>;
+    using ValueType = typename ResultTraits<ItemResult>::ValueType;
+    using Error = typename ResultTraits<ItemResult>::Error;
+    // 只有在输入是非 const 的右值时才移出其中的值
+    static constexpr bool kMove = !std::is_lvalue_reference_v<Range> &&
+                                  !std::is_const_v<std::remove_reference_t<Range>>;
+
+    template <typename Item>
+    static decltype(auto) TakeValue(Item& item) {
+        if constexpr (kMove)
+            return std::move(item.Value());
+        else
+            return static_cast<const ValueType&>(item.Value());
+    }
+};
+
+template <typename Range>
+auto Collect(Range&& results) {
+    using Traits = CollectTraits<Range>;
+    using Output = Result<std::vector<typename Traits::ValueType>, typename Traits::Error>;
+
+    std::vector<typename Traits::ValueType> values;
+    if constexpr (std::ranges::forward_range<Range>) {
+        std::size_t n = 0;
+        for (auto& item : results) {
+            if (!item.OK()) return Output(item.Error());
+            ++n;
+        }
+        values.reserve(n);
+        for (auto& item : results) values.push_back(Traits::TakeValue(item));
+    } else {
+        for (auto&& item : results) {
+            if (!item.OK()) return Output(item.Error());
+            values.push_back(Traits::TakeValue(item));
+        }
+    }
+    return Output(std::move(values));
+}
+
+template <typename Range>
+auto CollectAllErrors(Range&& results) {
+    using Traits = CollectTraits<Range>;
+    using Output = Result<std::vector<typename Traits::ValueType>,
+                          ErrorList<typename Traits::Error>>;
+
+    std::vector<typename Traits::ValueType> values;
+    ErrorList<typename Traits::Error> errors;
+    if constexpr (std::ranges::sized_range<Range>)
+        values.reserve(std::ranges::size(results));
+    for (auto&& item : results) {
+        if (!item.OK())
+            errors.Add(item.Error());
+        else if (!errors)
+            values.push_back(Traits::TakeValue(item));
+    }
+    if (errors) return Output(std::move(errors));
+    return Output(std::move(values));
+}
+
+#endif // ERROR_HANDLING_COLLECT_H_
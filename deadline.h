@@ -0,0 +1,120 @@
+#ifndef ERROR_HANDLING_DEADLINE_H_
+#define ERROR_HANDLING_DEADLINE_H_
+
+// 给 Future 和 Task 加上超时，超时以 DeadlineExceeded 错误出现在同一个 Result 里：
+//
+//   Future<int> f = WithDeadline(timers, client.Get(key), std::chrono::milliseconds(50));
+//   auto n = co_await WithDeadline(timers, pool, LoadTask(), std::chrono::seconds(1), source);
+//
+// 原来的操作和定时器谁先完成就用谁的结果，另一方的结果被丢弃；操作先完成时取消定时器。
+// 超时并不会中止原来的操作，Task 的版本可以传入 CancellationSource，超时时发出取消，
+// 让任务自己尽快结束。超时的结果在 TimerService 的线程里设置，TimerService 要比这些
+// Future 活得更久。
+//
+// 同步的代码可以用 Deadline 在适当的地方检查：TRY(deadline.Check());
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "cancellation.h"
+#include "future.h"
+#include "result.h"
+#include "task.h"
+#include "timer_wheel.h"
+
+namespace deadline_internal {
+
+// 原来的操作和定时器竞争完成同一个 Promise
+template <typename T, typename ErrorType>
+struct Race {
+    std::atomic<bool> done{false};
+    Promise<T, ErrorType> promise;
+    TimerId timer;
+    std::optional<CancellationSource> source;  // 超时的时候取消
+
+    void Complete(Result<T, ErrorType>&& result, TimerService& timers) {
+        if (done.exchange(true, std::memory_order_acq_rel)) return;
+        timers.Cancel(timer);
+        promise.SetResult(std::move(result));
+    }
+
+    void Expire() {
+        if (done.exchange(true, std::memory_order_acq_rel)) return;
+        if (source) source->Cancel();
+        promise.SetError(ErrorType(DeadlineExceeded(DeadlineErrorCode::kDeadlineExceeded)));
+    }
+};
+
+// 返回的 Future 在启动定时器之前取出，定时器到期时 Promise 已经不会再被调用者访问
+template <typename T, typename ErrorType>
+std::shared_ptr<Race<T, ErrorType>> StartRace(TimerService& timers, std::chrono::steady_clock::duration timeout,
+                                              std::optional<CancellationSource> source,
+                                              Future<T, ErrorType>* future) {
+    static_assert(std::is_constructible_v<ErrorType, DeadlineExceeded>,
+                  "the error type must be able to hold DeadlineExceeded");
+    auto race = std::make_shared<Race<T, ErrorType>>();
+    race->source = std::move(source);
+    *future = race->promise.GetFuture();
+    // 在登记完成回调之前确定 timer，完成回调里才能取消它
+    race->timer = timers.ScheduleAfter(timeout, [race] { race->Expire(); });
+    return race;
+}
+
+} // namespace deadline_internal
+
+// future 在 timeout 内没有完成时，返回的 Future 以 DeadlineExceeded 完成
+template <typename T, typename ErrorType>
+Future<T, ErrorType> WithDeadline(TimerService& timers, Future<T, ErrorType> future,
+                                  std::chrono::steady_clock::duration timeout) {
+    Future<T, ErrorType> result;
+    auto race = deadline_internal::StartRace(timers, timeout, std::nullopt, &result);
+    std::move(future).Then([race, &timers](Result<T, ErrorType>&& r) { race->Complete(std::move(r), timers); });
+    return result;
+}
+
+// 在 executor 里运行 task，timeout 内没有完成时返回的 Future 以 DeadlineExceeded 完成，
+// 同时通过 source 通知任务取消
+template <typename Executor, typename T, typename ErrorType>
+Future<T, ErrorType> WithDeadline(TimerService& timers, Executor& executor, Task<T, ErrorType> task,
+                                  std::chrono::steady_clock::duration timeout,
+                                  std::optional<CancellationSource> source = std::nullopt) {
+    Future<T, ErrorType> result;
+    auto race = deadline_internal::StartRace(timers, timeout, std::move(source), &result);
+    Spawn(executor, std::move(task),
+          [race, &timers](Result<T, ErrorType>&& r) { race->Complete(std::move(r), timers); });
+    return result;
+}
+
+// 同步代码里的截止时间，检查一次读一次时钟
+class Deadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Deadline(Clock::time_point at) : at_(at) {}
+
+    static Deadline After(Clock::duration timeout) {
+        return Deadline(Clock::now() + timeout);
+    }
+
+    Clock::time_point At() const {
+        return at_;
+    }
+
+    bool Expired() const {
+        return Clock::now() >= at_;
+    }
+
+    Result<void, DeadlineExceeded> Check() const {
+        if (Expired()) return DeadlineExceeded(DeadlineErrorCode::kDeadlineExceeded);
+        return {};
+    }
+
+private:
+    Clock::time_point at_;
+};
+
+#endif // ERROR_HANDLING_DEADLINE_H_
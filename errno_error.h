@@ -0,0 +1,15 @@
+#ifndef ERROR_HANDLING_ERRNO_ERROR_H_
+#define ERROR_HANDLING_ERRNO_ERROR_H_
+
+#include "result.h"
+
+// 以 errno 为错误码的错误，用法：return ErrnoError(ErrnoType(errno));
+enum class ErrnoType {
+};
+
+using ErrnoError = TypedError<ErrnoType>;
+
+// 读写文件、管道、套接字等 I/O 操作的错误，错误码就是系统调用失败时的 errno
+using IoError = ErrnoError;
+
+#endif // ERROR_HANDLING_ERRNO_ERROR_H_
@@ -0,0 +1,349 @@
+#ifndef ERROR_HANDLING_FALLIBLE_CONTAINERS_H_
+#define ERROR_HANDLING_FALLIBLE_CONTAINERS_H_
+
+// 分配失败时返回错误而不是抛出异常的容器，可以用于 -fno-exceptions 的构建：
+//
+//   Vector<int> v;
+//   TRY(v.TryPushBack(1));          // 内存不足时返回 AllocError
+//   String s;
+//   TRY(s.TryAppend("hello"));
+//   HashMap<std::string, int> m;
+//   TRY(m.TryEmplace("a", 1));
+//
+// 所有可能分配内存的操作都以 Try 开头，返回 Result<..., AllocError>；失败时容器保持原样。
+// 拷贝也会分配内存，所以 Vector 和 String 不能拷贝，要用返回 Result 的 Clone()。
+// 元素自身的构造函数不应抛出异常。
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "alloc_error.h"
+#include "flat_hash_map.h"
+#include "result.h"
+
+namespace fallible_internal {
+
+// p 是否指向 [begin, begin + size) 之内，用于处理追加自身元素的情况
+template <typename T>
+bool PointsInto(const T* begin, std::size_t size, const T* p) {
+    return std::less_equal<const T*>()(begin, p) && std::less<const T*>()(p, begin + size);
+}
+
+} // namespace fallible_internal
+
+// 用 malloc/realloc 管理内存的动态数组
+template <typename T>
+class Vector {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+
+public:
+    Vector() {}
+
+    Vector(Vector&& src) noexcept
+        : data_(std::exchange(src.data_, nullptr)),
+          size_(std::exchange(src.size_, 0)),
+          capacity_(std::exchange(src.capacity_, 0)) {}
+
+    Vector& operator=(Vector&& src) noexcept {
+        if (this != &src) {
+            Release();
+            data_ = std::exchange(src.data_, nullptr);
+            size_ = std::exchange(src.size_, 0);
+            capacity_ = std::exchange(src.capacity_, 0);
+        }
+        return *this;
+    }
+
+    Vector(const Vector&) = delete;
+    Vector& operator=(const Vector&) = delete;
+
+    ~Vector() {
+        Release();
+    }
+
+    Result<Vector, AllocError> Clone() const {
+        Vector copy;
+        auto appended = copy.TryAppend(data_, size_);
+        if (!appended.OK()) return appended.Error();
+        return copy;
+    }
+
+    std::size_t Size() const {
+        return size_;
+    }
+    std::size_t Capacity() const {
+        return capacity_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+    static constexpr std::size_t MaxSize() {
+        return PTRDIFF_MAX / sizeof(T);
+    }
+
+    T* Data() {
+        return data_;
+    }
+    const T* Data() const {
+        return data_;
+    }
+    T& operator[](std::size_t i) {
+        return data_[i];
+    }
+    const T& operator[](std::size_t i) const {
+        return data_[i];
+    }
+    T& Back() {
+        return data_[size_ - 1];
+    }
+    const T& Back() const {
+        return data_[size_ - 1];
+    }
+    T* begin() {
+        return data_;
+    }
+    T* end() {
+        return data_ + size_;
+    }
+    const T* begin() const {
+        return data_;
+    }
+    const T* end() const {
+        return data_ + size_;
+    }
+
+    // 把容量设为至少 n，和 std::vector::reserve 一样不多分配
+    Result<void, AllocError> TryReserve(std::size_t n) {
+        if (n <= capacity_) return {};
+        if (n > MaxSize()) return LengthError();
+        return Reallocate(n);
+    }
+
+    // 保证还能再放下 n 个元素，容量按倍数增长，反复调用的均摊开销是常数
+    Result<void, AllocError> TryReserveAdditional(std::size_t n) {
+        if (n <= capacity_ - size_) return {};
+        if (n > MaxSize() - size_) return LengthError();
+        return Reallocate(GrownCapacity(size_ + n));
+    }
+
+    Result<void, AllocError> TryPushBack(const T& value) {
+        return TryEmplaceBack(value);
+    }
+    Result<void, AllocError> TryPushBack(T&& value) {
+        return TryEmplaceBack(std::move(value));
+    }
+
+    // args 可以引用容器里已有的元素
+    template <typename... Args>
+    Result<void, AllocError> TryEmplaceBack(Args&&... args) {
+        if (size_ == capacity_) return EmplaceBackSlow(std::forward<Args>(args)...);
+        new (data_ + size_) T(std::forward<Args>(args)...);
+        ++size_;
+        return {};
+    }
+
+    // 追加 [p, p + n)，p 可以指向容器自身
+    Result<void, AllocError> TryAppend(const T* p, std::size_t n) {
+        if (n > capacity_ - size_) {
+            const bool self = fallible_internal::PointsInto<T>(data_, size_, p);
+            const std::size_t offset = self ? p - data_ : 0;
+            auto reserved = TryReserveAdditional(n);
+            if (!reserved.OK()) return reserved;
+            if (self) p = data_ + offset;
+        }
+        std::uninitialized_copy(p, p + n, data_ + size_);
+        size_ += n;
+        return {};
+    }
+
+    // 变长时新的元素值初始化
+    Result<void, AllocError> TryResize(std::size_t n) {
+        if (n <= size_) {
+            std::destroy(data_ + n, data_ + size_);
+            size_ = n;
+            return {};
+        }
+        auto reserved = TryReserve(n);
+        if (!reserved.OK()) return reserved;
+        std::uninitialized_value_construct(data_ + size_, data_ + n);
+        size_ = n;
+        return {};
+    }
+
+    void PopBack() {
+        data_[--size_].~T();
+    }
+
+    void Clear() {
+        std::destroy(data_, data_ + size_);
+        size_ = 0;
+    }
+
+private:
+    std::size_t GrownCapacity(std::size_t min_capacity) const {
+        std::size_t capacity = capacity_ < MaxSize() / 2 ? capacity_ * 2 : MaxSize();
+        if (capacity < 4) capacity = 4;
+        return capacity < min_capacity ? min_capacity : capacity;
+    }
+
+    Result<void, AllocError> Reallocate(std::size_t capacity) {
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            void* data = std::realloc(data_, capacity * sizeof(T));
+            if (data == nullptr) return OutOfMemoryError();
+            data_ = static_cast<T*>(data);
+        } else {
+            T* data = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+            if (data == nullptr) return OutOfMemoryError();
+            Relocate(data);
+            data_ = data;
+        }
+        capacity_ = capacity;
+        return {};
+    }
+
+    // 满的时候先在新的内存里构造新元素，再搬移旧元素，这样 args 引用旧元素也是安全的
+    template <typename... Args>
+    Result<void, AllocError> EmplaceBackSlow(Args&&... args) {
+        if (size_ == MaxSize()) return LengthError();
+        const std::size_t capacity = GrownCapacity(size_ + 1);
+        T* data = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+        if (data == nullptr) return OutOfMemoryError();
+        new (data + size_) T(std::forward<Args>(args)...);
+        Relocate(data);
+        data_ = data;
+        capacity_ = capacity;
+        ++size_;
+        return {};
+    }
+
+    // 把元素移到 data，释放原来的内存
+    void Relocate(T* data) {
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            if (size_ != 0) std::memcpy(static_cast<void*>(data), data_, size_ * sizeof(T));
+        } else {
+            std::uninitialized_move(data_, data_ + size_, data);
+            std::destroy(data_, data_ + size_);
+        }
+        std::free(data_);
+    }
+
+    void Release() {
+        std::destroy(data_, data_ + size_);
+        std::free(data_);
+    }
+
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t capacity_ = 0;
+};
+
+// 以 '\0' 结尾的字符串
+class String {
+public:
+    String() {}
+
+    static Result<String, AllocError> From(std::string_view s) {
+        String result;
+        auto appended = result.TryAppend(s);
+        if (!appended.OK()) return appended.Error();
+        return result;
+    }
+
+    Result<String, AllocError> Clone() const {
+        return From(View());
+    }
+
+    std::size_t Size() const {
+        return chars_.Size();
+    }
+    std::size_t Capacity() const {
+        return chars_.Capacity() == 0 ? 0 : chars_.Capacity() - 1;
+    }
+    bool Empty() const {
+        return chars_.Empty();
+    }
+
+    const char* Data() const {
+        return chars_.Data() == nullptr ? "" : chars_.Data();
+    }
+    const char* CStr() const {
+        return Data();
+    }
+    std::string_view View() const {
+        return std::string_view(Data(), Size());
+    }
+    operator std::string_view() const {
+        return View();
+    }
+    char& operator[](std::size_t i) {
+        return chars_[i];
+    }
+    char operator[](std::size_t i) const {
+        return chars_[i];
+    }
+    char* begin() {
+        return chars_.begin();
+    }
+    char* end() {
+        return chars_.end();
+    }
+    const char* begin() const {
+        return chars_.begin();
+    }
+    const char* end() const {
+        return chars_.end();
+    }
+
+    Result<void, AllocError> TryReserve(std::size_t n) {
+        if (n >= Vector<char>::MaxSize()) return LengthError();
+        return chars_.TryReserve(n + 1);
+    }
+
+    // s 可以是自身的一部分
+    Result<void, AllocError> TryAppend(std::string_view s) {
+        // 多留一个字节放 '\0'
+        if (s.size() >= chars_.Capacity() - chars_.Size()) {
+            const bool self = fallible_internal::PointsInto(chars_.Data(), chars_.Size(), s.data());
+            const std::size_t offset = self ? s.data() - chars_.Data() : 0;
+            auto reserved = chars_.TryReserveAdditional(s.size() + 1);
+            if (!reserved.OK()) return reserved;
+            if (self) s = std::string_view(chars_.Data() + offset, s.size());
+        }
+        auto appended = chars_.TryAppend(s.data(), s.size());  // 容量已经够了，不会失败
+        chars_.Data()[chars_.Size()] = '\0';
+        return appended;
+    }
+
+    Result<void, AllocError> TryPushBack(char c) {
+        return TryAppend(std::string_view(&c, 1));
+    }
+
+    void Clear() {
+        chars_.Clear();
+        if (chars_.Data() != nullptr) chars_.Data()[0] = '\0';
+    }
+
+    friend bool operator==(const String& lhs, std::string_view rhs) {
+        return lhs.View() == rhs;
+    }
+    friend bool operator!=(const String& lhs, std::string_view rhs) {
+        return lhs.View() != rhs;
+    }
+
+private:
+    Vector<char> chars_;  // 容量总是比长度多至少一个字节，存放结尾的 '\0'
+};
+
+// FlatHashMap 的 TryEmplace 和 TryReserve 在分配失败时返回 AllocError
+template <typename Key, typename Value, typename Hash = FlatHash<Key>, typename KeyEqual = std::equal_to<>>
+using HashMap = FlatHashMap<Key, Value, Hash, KeyEqual>;
+
+#endif // ERROR_HANDLING_FALLIBLE_CONTAINERS_H_
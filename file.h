@@ -0,0 +1,128 @@
+#ifndef ERROR_HANDLING_FILE_H_
+#define ERROR_HANDLING_FILE_H_
+
+// 基于 POSIX 的只读文件，读取时用 mmap 把整个文件映射进来，不拷贝内容：
+//
+//   auto&& file = TRY(OpenFile("numbers.txt"));
+//   std::string_view text = TRY(file.Read());   // 在 file 销毁之前一直有效
+//   auto&& numbers = TRY(ParseIntegerLines<int64_t>(pool, text));
+//
+// 打开和映射失败时返回带有真实 errno 的 ErrnoError。映射后用 madvise 告诉内核
+// 访问的模式，顺序读取时内核会加大预读；Read 里 madvise 失败不算错误。
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "errno_error.h"
+#include "result.h"
+
+// 对映射内容的访问模式，对应 madvise 的参数
+enum class AccessPattern {
+    kNormal,
+    kSequential,  // 从头到尾读一遍，加大预读，读过的页可以尽早回收
+    kRandom,      // 随机访问，不做预读
+    kWillNeed,    // 马上就要全部读取，提前把整个文件读进页缓存
+};
+
+class File {
+public:
+    File() {}
+    // 接管已经打开的 fd
+    explicit File(int fd) : fd_(fd) {}
+
+    File(File&& src) noexcept
+        : fd_(std::exchange(src.fd_, -1)),
+          data_(std::exchange(src.data_, nullptr)),
+          size_(std::exchange(src.size_, 0)) {}
+
+    File& operator=(File&& src) noexcept {
+        if (this != &src) {
+            Close();
+            fd_ = std::exchange(src.fd_, -1);
+            data_ = std::exchange(src.data_, nullptr);
+            size_ = std::exchange(src.size_, 0);
+        }
+        return *this;
+    }
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    ~File() {
+        Close();
+    }
+
+    int Fd() const {
+        return fd_;
+    }
+
+    Result<std::size_t, ErrnoError> Size() const {
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) return ErrnoError(ErrnoType(errno));
+        return static_cast<std::size_t>(st.st_size);
+    }
+
+    // 返回文件的全部内容，第一次调用时建立映射，之后返回同一个映射。
+    // 返回的 string_view 在 File 销毁之前有效，移动 File 不影响它。
+    Result<std::string_view, ErrnoError> Read(AccessPattern pattern = AccessPattern::kSequential) {
+        if (!data_) {
+            auto size = Size();
+            if (!size.OK()) return size.Error();
+            // 长度为 0 的 mmap 会失败，空文件直接返回空的内容
+            if (size.Value() == 0) return std::string_view();
+            void* data = ::mmap(nullptr, size.Value(), PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (data == MAP_FAILED) return ErrnoError(ErrnoType(errno));
+            data_ = data;
+            size_ = size.Value();
+            // madvise 只是建议，失败时映射仍然可用，忽略错误
+            (void)Advise(pattern);
+        }
+        return std::string_view(static_cast<const char*>(data_), size_);
+    }
+
+    // 改变已经建立的映射的访问模式
+    Result<void, ErrnoError> Advise(AccessPattern pattern) {
+        if (!data_) return Result<void, ErrnoError>();
+        int advice = MADV_NORMAL;
+        switch (pattern) {
+        case AccessPattern::kNormal: advice = MADV_NORMAL; break;
+        case AccessPattern::kSequential: advice = MADV_SEQUENTIAL; break;
+        case AccessPattern::kRandom: advice = MADV_RANDOM; break;
+        case AccessPattern::kWillNeed: advice = MADV_WILLNEED; break;
+        }
+        if (::madvise(data_, size_, advice) != 0) return ErrnoError(ErrnoType(errno));
+        return Result<void, ErrnoError>();
+    }
+
+private:
+    void Close() {
+        if (data_) ::munmap(data_, size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    int fd_ = -1;
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+inline Result<File, ErrnoError> OpenFile(const std::string& path) {
+    int fd;
+    do {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) return ErrnoError(ErrnoType(errno));
+    return File(fd);
+}
+
+#endif // ERROR_HANDLING_FILE_H_
@@ -0,0 +1,301 @@
+#ifndef ERROR_HANDLING_FILE_OPENER_H_
+#define ERROR_HANDLING_FILE_OPENER_H_
+
+// 打开大量位于少数几个目录下的文件：
+//
+//   FileOpener opener;
+//   std::vector<Result<File, ErrnoError>> files = opener.OpenBatch({"data/a", "data/b", "data/c"});
+//   Result<File, ErrnoError> file = opener.Open("data/d");
+//
+// 每个目录只打开一次，之后用缓存的目录 fd 和 openat 打开其中的文件，内核不用每次都
+// 解析完整的路径。不存在的文件（ENOENT）会记在负缓存里，在 TTL 内再打开时直接返回错误。
+// 每个缓存的目录都用 inotify 监视，目录里新建或移入文件时对应的负缓存立即失效，
+// 目录本身被删除或移走时丢弃它的 fd。同一个目录的不同写法（data 和 data/.）共用一个 fd 和监视。
+// 不能监视的目录（inotify 不可用或者 inotify_add_watch 失败）不缓存，每次批量打开时重新打开。
+// 相对路径每次都直接用 open 打开，不经过缓存，所以 chdir 之后的结果和 OpenFile 一致。
+//
+// 批量打开时只加两次锁：先一次查好所有的目录和负缓存，openat 在锁外执行，最后一次记录结果。
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "errno_error.h"
+#include "file.h"
+#include "result.h"
+
+struct FileOpenerOptions {
+    std::chrono::steady_clock::duration negative_ttl = std::chrono::seconds(1);
+    std::size_t max_directories = 64;       // 最多缓存的目录 fd 个数，超过时淘汰最久未用的
+    std::size_t max_negative_per_directory = 4096;
+    bool use_inotify = true;
+    int flags = O_RDONLY;                   // 打开文件的标志，总是会加上 O_CLOEXEC
+};
+
+class FileOpener {
+public:
+    explicit FileOpener(FileOpenerOptions options = {}) : options_(options) {
+        if (options_.use_inotify) inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+
+    ~FileOpener() {
+        // 目录可能还被正在进行的 Open 引用，由 shared_ptr 负责关闭它们的 fd
+        if (inotify_fd_ >= 0) ::close(inotify_fd_);
+    }
+
+    FileOpener(const FileOpener&) = delete;
+    FileOpener& operator=(const FileOpener&) = delete;
+
+    Result<File, ErrnoError> Open(const std::string& path) {
+        std::vector<Result<File, ErrnoError>> results = OpenBatch({path});
+        return std::move(results[0]);
+    }
+
+    // 结果和 paths 一一对应
+    std::vector<Result<File, ErrnoError>> OpenBatch(const std::vector<std::string>& paths) {
+        const auto now = std::chrono::steady_clock::now();
+        std::vector<Request> requests(paths.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            DrainEvents();
+            for (std::size_t i = 0; i < paths.size(); ++i) Prepare(paths[i], now, &requests[i]);
+        }
+
+        std::vector<Result<File, ErrnoError>> results;
+        results.reserve(paths.size());
+        bool any_missing = false;
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            Request& request = requests[i];
+            if (request.error != 0) {
+                results.push_back(ErrnoError(ErrnoType(request.error)));
+                continue;
+            }
+            int fd;
+            do {
+                fd = request.directory
+                         ? ::openat(request.directory->fd, request.name.c_str(), options_.flags | O_CLOEXEC)
+                         : ::open(paths[i].c_str(), options_.flags | O_CLOEXEC);
+            } while (fd < 0 && errno == EINTR);
+            if (fd >= 0) {
+                results.push_back(File(fd));
+            } else {
+                request.error = errno;
+                any_missing |= request.error == ENOENT && request.directory;
+                results.push_back(ErrnoError(ErrnoType(request.error)));
+            }
+        }
+
+        if (any_missing) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // openat 之后目录里可能新建了文件，先处理积压的事件；查负缓存之后处理过这个目录的事件时
+            // 不知道文件是在 openat 之前还是之后出现的，不记录
+            DrainEvents();
+            for (auto& request : requests) {
+                if (request.error == ENOENT && request.directory && !request.cached_miss &&
+                    request.directory->events == request.events)
+                    RememberMissing(*request.directory, request.name, now);
+            }
+        }
+        return results;
+    }
+
+    // 丢弃所有的缓存
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : directories_) Unwatch(*entry.second.directory);
+        directories_.clear();
+        lru_.clear();
+        by_watch_.clear();
+        by_inode_.clear();
+    }
+
+    std::size_t CachedDirectories() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return directories_.size();
+    }
+
+private:
+    struct Directory {
+        explicit Directory(int fd) : fd(fd) {}
+        ~Directory() {
+            ::close(fd);
+        }
+        int fd;
+        int watch = -1;
+        uint64_t events = 0;  // 已经处理的 inotify 事件数
+        dev_t device = 0;
+        ino_t inode = 0;
+        std::vector<std::string> paths;  // 缓存里指向这个目录的各种写法
+
+        // 不存在的文件名到过期时间
+        std::unordered_map<std::string, std::chrono::steady_clock::time_point> missing;
+    };
+
+    struct CacheEntry {
+        std::shared_ptr<Directory> directory;
+        std::list<std::string>::iterator lru;
+    };
+
+    struct Request {
+        std::shared_ptr<Directory> directory;  // 为空时直接用 open 打开整个路径
+        std::string name;
+        int error = 0;             // 已经确定的错误
+        bool cached_miss = false;  // 错误来自负缓存
+        uint64_t events = 0;       // 查负缓存时目录已经处理的事件数
+    };
+
+    // 在锁内为一个路径找到目录并检查负缓存
+    void Prepare(const std::string& path, std::chrono::steady_clock::time_point now, Request* request) {
+        std::size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        request->name = slash == std::string::npos ? path : path.substr(slash + 1);
+        if (request->name.empty() || path[0] != '/') return;  // 以 '/' 结尾或者相对路径，交给 open 处理
+
+        auto directory = GetDirectory(dir);
+        if (!directory.OK()) {
+            request->error = static_cast<int>(directory.Error().Code());
+            return;
+        }
+        request->directory = directory.Value();
+        request->events = request->directory->events;
+        auto it = request->directory->missing.find(request->name);
+        if (it == request->directory->missing.end()) return;
+        if (it->second > now) {
+            request->error = ENOENT;
+            request->cached_miss = true;
+        } else {
+            request->directory->missing.erase(it);
+        }
+    }
+
+    Result<std::shared_ptr<Directory>, ErrnoError> GetDirectory(const std::string& dir) {
+        auto it = directories_.find(dir);
+        if (it != directories_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return it->second.directory;
+        }
+        if (directories_.size() >= options_.max_directories && !lru_.empty()) Evict(lru_.back());
+        int fd;
+        do {
+            fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) return ErrnoError(ErrnoType(errno));
+
+        auto directory = std::make_shared<Directory>(fd);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) return ErrnoError(ErrnoType(errno));
+        directory->device = st.st_dev;
+        directory->inode = st.st_ino;
+        auto same = by_inode_.find({st.st_dev, st.st_ino});
+        if (same != by_inode_.end()) {
+            // 已经用别的写法缓存了这个目录，共用它的 fd 和监视
+            directory = same->second;
+        } else {
+            // 不能监视的目录无法知道它什么时候被移走或者新建了文件，只在这一次打开里使用
+            if (inotify_fd_ < 0) return directory;
+            directory->watch = ::inotify_add_watch(
+                inotify_fd_, dir.c_str(), IN_CREATE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+            if (directory->watch < 0) return directory;
+            by_watch_[directory->watch] = directory.get();
+            by_inode_.emplace(std::make_pair(st.st_dev, st.st_ino), directory);
+        }
+        lru_.push_front(dir);
+        directories_.emplace(dir, CacheEntry{directory, lru_.begin()});
+        directory->paths.push_back(dir);
+        return directory;
+    }
+
+    // 从缓存里去掉一种写法，目录的最后一种写法也去掉时停止监视
+    void Evict(std::string dir) {
+        auto it = directories_.find(dir);
+        if (it == directories_.end()) return;
+        std::shared_ptr<Directory> directory = it->second.directory;
+        lru_.erase(it->second.lru);
+        directories_.erase(it);
+        std::erase(directory->paths, dir);
+        if (directory->paths.empty()) {
+            Unwatch(*directory);
+            by_inode_.erase({directory->device, directory->inode});
+        }
+    }
+
+    // 目录被删除或移走，去掉它的所有写法
+    void EvictAll(Directory& directory) {
+        std::vector<std::string> paths = directory.paths;
+        for (auto& path : paths) Evict(path);
+    }
+
+    void Unwatch(Directory& directory) {
+        if (directory.watch < 0) return;
+        by_watch_.erase(directory.watch);
+        ::inotify_rm_watch(inotify_fd_, directory.watch);
+        directory.watch = -1;
+    }
+
+    void RememberMissing(Directory& directory, const std::string& name,
+                         std::chrono::steady_clock::time_point now) {
+        if (directory.missing.size() >= options_.max_negative_per_directory) {
+            std::erase_if(directory.missing, [&](const auto& entry) { return entry.second <= now; });
+            if (directory.missing.size() >= options_.max_negative_per_directory) directory.missing.clear();
+        }
+        directory.missing[name] = now + options_.negative_ttl;
+    }
+
+    // 处理积压的 inotify 事件，在锁内调用
+    void DrainEvents() {
+        if (inotify_fd_ < 0) return;
+        alignas(inotify_event) char buffer[4096];
+        for (;;) {
+            ssize_t n = ::read(inotify_fd_, buffer, sizeof(buffer));
+            if (n <= 0) return;
+            for (char* p = buffer; p < buffer + n;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // 丢失了事件，无法知道哪些负缓存失效了、哪些目录被移走了，全部丢弃
+                    for (auto& entry : directories_) {
+                        entry.second.directory->missing.clear();
+                        ++entry.second.directory->events;
+                    }
+                    std::vector<std::string> all(lru_.begin(), lru_.end());
+                    for (auto& dir : all) Evict(dir);
+                    continue;
+                }
+                auto it = by_watch_.find(event->wd);
+                if (it == by_watch_.end()) continue;
+                Directory* directory = it->second;
+                ++directory->events;
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    EvictAll(*directory);
+                } else if (event->len > 0) {
+                    directory->missing.erase(event->name);
+                }
+            }
+        }
+    }
+
+    const FileOpenerOptions options_;
+    int inotify_fd_ = -1;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, CacheEntry> directories_;
+    std::list<std::string> lru_;  // 最近用过的目录在前面
+    std::unordered_map<int, Directory*> by_watch_;
+    std::map<std::pair<dev_t, ino_t>, std::shared_ptr<Directory>> by_inode_;
+};
+
+#endif // ERROR_HANDLING_FILE_OPENER_H_
@@ -0,0 +1,404 @@
+#ifndef ERROR_HANDLING_FLAT_HASH_MAP_H_
+#define ERROR_HANDLING_FLAT_HASH_MAP_H_
+
+// 开放寻址的哈希表，布局和探测方式仿照 Swiss table：
+//
+//   FlatHashMap<std::string, int> map = {{"a", 1}, {"b", 2}};
+//   Result<const int&, LookupError> v = map.Find(std::string_view("a"));  // 不构造临时的 std::string
+//   if (!v.OK()) ...                                                      // 找不到时返回错误而不是抛异常
+//
+// 每个槽位对应一个控制字节：空、已删除，或者是哈希值的低 7 位（H2）。槽位 16 个一组，
+// 查找时用哈希值的高位（H1）选择起始组，再用 SSE2 一次比较一组 16 个控制字节，
+// 只对 H2 相同的槽位比较键；组内有空槽位时说明查找的键不存在。组之间按三角数序列探测，
+// 组数是 2 的幂，所以能遍历所有的组。键和值连续存放，没有链表节点。
+//
+// 找不到时返回的 LookupError 是同一个共享的对象，不分配内存。
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "alloc_error.h"
+#include "result.h"
+
+enum class LookupErrorCode {
+    kNotFound = 1,
+};
+
+using LookupError = TypedError<LookupErrorCode>;
+
+// 默认的哈希函数。std::string 的版本对 std::string、std::string_view 和 const char*
+// 计算出相同的哈希值，因此可以用它们直接查找
+template <typename Key>
+struct FlatHash : std::hash<Key> {};
+
+template <>
+struct FlatHash<std::string> {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const {
+        return std::hash<std::string_view>()(s);
+    }
+};
+
+namespace flat_hash_internal {
+
+constexpr int8_t kEmpty = -128;  // 0b10000000
+constexpr int8_t kDeleted = -2;  // 0b11111110，满的槽位是 0..127，最高位为 0
+constexpr std::size_t kGroupWidth = 16;
+
+// 一组控制字节上的匹配，结果的第 i 位对应组内第 i 个槽位
+class Group {
+public:
+#if defined(__SSE2__)
+    explicit Group(const int8_t* ctrl) : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+    uint32_t Match(int8_t h2) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_));
+    }
+    uint32_t MatchEmpty() const {
+        return Match(kEmpty);
+    }
+    // 空的和已删除的槽位的最高位都是 1
+    uint32_t MatchEmptyOrDeleted() const {
+        return _mm_movemask_epi8(ctrl_);
+    }
+
+private:
+    __m128i ctrl_;
+#else
+    explicit Group(const int8_t* ctrl) {
+        std::memcpy(ctrl_, ctrl, kGroupWidth);
+    }
+
+    uint32_t Match(int8_t h2) const {
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < kGroupWidth; ++i) mask |= uint32_t(ctrl_[i] == h2) << i;
+        return mask;
+    }
+    uint32_t MatchEmpty() const {
+        return Match(kEmpty);
+    }
+    uint32_t MatchEmptyOrDeleted() const {
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < kGroupWidth; ++i) mask |= uint32_t(ctrl_[i] < 0) << i;
+        return mask;
+    }
+
+private:
+    int8_t ctrl_[kGroupWidth];
+#endif
+};
+
+// 容量超出范围，不带异常编译时终止程序
+[[noreturn]] inline void ThrowLengthError() {
+#if defined(__cpp_exceptions)
+    throw std::length_error("FlatHashMap: too many elements");
+#else
+    std::abort();
+#endif
+}
+
+} // namespace flat_hash_internal
+
+template <typename Key, typename Value, typename Hash = FlatHash<Key>, typename KeyEqual = std::equal_to<>>
+class FlatHashMap {
+public:
+    FlatHashMap() {}
+
+    FlatHashMap(std::initializer_list<std::pair<Key, Value>> init) {
+        Reserve(init.size());
+        for (auto& entry : init) Emplace(entry.first, entry.second);
+    }
+
+    FlatHashMap(const FlatHashMap& src) {
+        Reserve(src.size_);
+        src.ForEach([this](const Key& key, const Value& value) { Emplace(key, value); });
+    }
+
+    FlatHashMap(FlatHashMap&& src) noexcept
+        : ctrl_(std::exchange(src.ctrl_, nullptr)),
+          slots_(std::exchange(src.slots_, nullptr)),
+          capacity_(std::exchange(src.capacity_, 0)),
+          size_(std::exchange(src.size_, 0)),
+          growth_left_(std::exchange(src.growth_left_, 0)) {}
+
+    FlatHashMap& operator=(FlatHashMap src) noexcept {
+        std::swap(ctrl_, src.ctrl_);
+        std::swap(slots_, src.slots_);
+        std::swap(capacity_, src.capacity_);
+        std::swap(size_, src.size_);
+        std::swap(growth_left_, src.growth_left_);
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        Release();
+    }
+
+    std::size_t Size() const {
+        return size_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    template <typename K>
+    Result<const Value&, LookupError> Find(const K& key) const {
+        std::size_t index = FindIndex(key);
+        if (index == kNotFound) return NotFoundError();
+        return slots_[index].second;
+    }
+
+    template <typename K>
+    Result<Value&, LookupError> Find(const K& key) {
+        std::size_t index = FindIndex(key);
+        if (index == kNotFound) return NotFoundError();
+        return slots_[index].second;
+    }
+
+    template <typename K>
+    bool Contains(const K& key) const {
+        return FindIndex(key) != kNotFound;
+    }
+
+    // 键不存在时以 args 构造值并插入。返回值的位置，以及是否插入了新的元素
+    template <typename K, typename... Args>
+    std::pair<Value*, bool> Emplace(K&& key, Args&&... args) {
+        return EmplaceImpl<false>(std::forward<K>(key), std::forward<Args>(args)...);
+    }
+
+    // 和 Emplace 相同，但是扩容失败时返回 AllocError 而不是抛出 std::bad_alloc，表保持原样
+    template <typename K, typename... Args>
+    Result<std::pair<Value*, bool>, AllocError> TryEmplace(K&& key, Args&&... args) {
+        auto result = EmplaceImpl<true>(std::forward<K>(key), std::forward<Args>(args)...);
+        if (result.first == nullptr) return OutOfMemoryError();
+        return result;
+    }
+
+    Value& operator[](const Key& key) {
+        return *Emplace(key).first;
+    }
+
+    template <typename K>
+    bool Erase(const K& key) {
+        std::size_t index = FindIndex(key);
+        if (index == kNotFound) return false;
+        slots_[index].~Slot();
+        --size_;
+        // 组内还有空槽位，说明这一组从未满过，不会有探测越过它，可以直接置为空
+        const std::size_t group = index & ~(flat_hash_internal::kGroupWidth - 1);
+        if (flat_hash_internal::Group(ctrl_ + group).MatchEmpty()) {
+            ctrl_[index] = flat_hash_internal::kEmpty;
+            ++growth_left_;
+        } else {
+            ctrl_[index] = flat_hash_internal::kDeleted;
+        }
+        return true;
+    }
+
+    void Clear() {
+        DestroySlots();
+        if (capacity_ != 0) std::memset(ctrl_, flat_hash_internal::kEmpty, capacity_);
+        size_ = 0;
+        growth_left_ = MaxLoad(capacity_);
+    }
+
+    // 预留至少能放下 n 个元素的空间
+    void Reserve(std::size_t n) {
+        const std::size_t capacity = CapacityFor(n);
+        if (capacity == 0) flat_hash_internal::ThrowLengthError();
+        if (capacity > capacity_) Rehash<false>(capacity);
+    }
+
+    Result<void, AllocError> TryReserve(std::size_t n) {
+        const std::size_t capacity = CapacityFor(n);
+        if (capacity == 0) return LengthError();
+        if (capacity > capacity_ && !Rehash<true>(capacity)) return OutOfMemoryError();
+        return {};
+    }
+
+    // 以 (const Key&, Value&) 遍历所有的元素，顺序不确定
+    template <typename Function>
+    void ForEach(Function function) {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            if (ctrl_[i] >= 0) function(const_cast<const Key&>(slots_[i].first), slots_[i].second);
+        }
+    }
+    template <typename Function>
+    void ForEach(Function function) const {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            if (ctrl_[i] >= 0) function(slots_[i].first, static_cast<const Value&>(slots_[i].second));
+        }
+    }
+
+private:
+    using Slot = std::pair<Key, Value>;
+
+    static constexpr std::size_t kNotFound = static_cast<std::size_t>(-1);
+    static constexpr std::size_t kMaxCapacity = PTRDIFF_MAX / (sizeof(Slot) + 1);
+    // 控制字节按组对齐，容量是 16 的倍数，所以紧跟在槽位后面也是对齐的
+    static constexpr std::align_val_t kAlignment{alignof(Slot) > 16 ? alignof(Slot) : 16};
+
+    static const LookupError& NotFoundError() {
+        static const LookupError error(LookupErrorCode::kNotFound);
+        return error;
+    }
+
+    // 最大负载因子为 7/8
+    static std::size_t MaxLoad(std::size_t capacity) {
+        return capacity - capacity / 8;
+    }
+
+    template <typename K>
+    std::size_t HashOf(const K& key) const {
+        // 标准库对整数的哈希是恒等映射，乘一个奇数常量把低位的变化扩散到高位
+        uint64_t h = static_cast<uint64_t>(Hash()(key)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+    static int8_t H2(std::size_t hash) {
+        return static_cast<int8_t>(hash & 0x7F);
+    }
+
+    std::size_t NumGroupsMask() const {
+        return capacity_ / flat_hash_internal::kGroupWidth - 1;
+    }
+
+    template <typename K>
+    std::size_t FindIndex(const K& key) const {
+        return FindIndex(key, HashOf(key));
+    }
+
+    template <typename K>
+    std::size_t FindIndex(const K& key, std::size_t hash) const {
+        if (capacity_ == 0) return kNotFound;
+        const int8_t h2 = H2(hash);
+        std::size_t group = (hash >> 7) & NumGroupsMask();
+        for (std::size_t step = 1;; ++step) {
+            const int8_t* ctrl = ctrl_ + group * flat_hash_internal::kGroupWidth;
+            flat_hash_internal::Group g(ctrl);
+            for (uint32_t mask = g.Match(h2); mask != 0; mask &= mask - 1) {
+                std::size_t index = group * flat_hash_internal::kGroupWidth + __builtin_ctz(mask);
+                if (KeyEqual()(slots_[index].first, key)) return index;
+            }
+            if (g.MatchEmpty() != 0 || step > NumGroupsMask()) return kNotFound;
+            group = (group + step) & NumGroupsMask();
+        }
+    }
+
+    // 探测序列上第一个空的或已删除的槽位，调用前要保证有空余
+    std::size_t FindInsertSlot(std::size_t hash) const {
+        std::size_t group = (hash >> 7) & NumGroupsMask();
+        for (std::size_t step = 1;; ++step) {
+            uint32_t mask = flat_hash_internal::Group(ctrl_ + group * flat_hash_internal::kGroupWidth)
+                                .MatchEmptyOrDeleted();
+            if (mask != 0) return group * flat_hash_internal::kGroupWidth + __builtin_ctz(mask);
+            group = (group + step) & NumGroupsMask();
+        }
+    }
+
+    // 已删除的槽位占了一半以上的余量时原地重建，否则扩大一倍
+    std::size_t NextCapacity() const {
+        if (capacity_ == 0) return flat_hash_internal::kGroupWidth;
+        if (size_ < MaxLoad(capacity_) / 2) return capacity_;
+        return capacity_ > kMaxCapacity / 2 ? 0 : capacity_ * 2;
+    }
+
+    // 能放下 n 个元素的容量，超出范围时返回 0
+    static std::size_t CapacityFor(std::size_t n) {
+        std::size_t capacity = flat_hash_internal::kGroupWidth;
+        while (MaxLoad(capacity) < n) {
+            if (capacity > kMaxCapacity / 2) return 0;
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    template <bool kNoThrow, typename K, typename... Args>
+    std::pair<Value*, bool> EmplaceImpl(K&& key, Args&&... args) {
+        const std::size_t hash = HashOf(key);
+        std::size_t index = FindIndex(key, hash);
+        if (index != kNotFound) return {&slots_[index].second, false};
+        if (growth_left_ == 0) {
+            const std::size_t capacity = NextCapacity();
+            if (capacity == 0) {
+                if constexpr (kNoThrow) return {nullptr, false};
+                flat_hash_internal::ThrowLengthError();
+            }
+            if (!Rehash<kNoThrow>(capacity)) return {nullptr, false};
+        }
+        index = FindInsertSlot(hash);
+        if (ctrl_[index] == flat_hash_internal::kEmpty) --growth_left_;
+        ctrl_[index] = H2(hash);
+        new (&slots_[index]) Slot(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                                  std::forward_as_tuple(std::forward<Args>(args)...));
+        ++size_;
+        return {&slots_[index].second, true};
+    }
+
+    // 槽位和控制字节放在同一块内存里，控制字节在后面。kNoThrow 时分配失败返回 false
+    template <bool kNoThrow>
+    bool Rehash(std::size_t capacity) {
+        void* memory = kNoThrow ? ::operator new(AllocationSize(capacity), kAlignment, std::nothrow)
+                                : ::operator new(AllocationSize(capacity), kAlignment);
+        if (memory == nullptr) return false;
+
+        int8_t* old_ctrl = ctrl_;
+        Slot* old_slots = slots_;
+        const std::size_t old_capacity = capacity_;
+
+        slots_ = static_cast<Slot*>(memory);
+        ctrl_ = reinterpret_cast<int8_t*>(slots_ + capacity);
+        std::memset(ctrl_, flat_hash_internal::kEmpty, capacity);
+        capacity_ = capacity;
+        growth_left_ = MaxLoad(capacity) - size_;
+
+        for (std::size_t i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] < 0) continue;
+            const std::size_t hash = HashOf(old_slots[i].first);
+            const std::size_t index = FindInsertSlot(hash);
+            ctrl_[index] = H2(hash);
+            new (&slots_[index]) Slot(std::move(old_slots[i]));
+            old_slots[i].~Slot();
+        }
+        if (old_capacity != 0) ::operator delete(old_slots, kAlignment);
+        return true;
+    }
+
+    static std::size_t AllocationSize(std::size_t capacity) {
+        return capacity * (sizeof(Slot) + 1);
+    }
+
+    void DestroySlots() {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            if (ctrl_[i] >= 0) slots_[i].~Slot();
+        }
+    }
+
+    void Release() {
+        if (capacity_ == 0) return;
+        DestroySlots();
+        ::operator delete(slots_, kAlignment);
+    }
+
+    int8_t* ctrl_ = nullptr;
+    Slot* slots_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    std::size_t growth_left_ = 0;
+};
+
+#endif // ERROR_HANDLING_FLAT_HASH_MAP_H_
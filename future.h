@@ -0,0 +1,301 @@
+#ifndef ERROR_HANDLING_FUTURE_H_
+#define ERROR_HANDLING_FUTURE_H_
+
+// 一次性的 Promise/Future，专门用来在线程之间传递 Result<T, E>。
+//
+// 同步只用一个原子状态字：生产者写入结果后置 kReady 位，消费者登记回调后置
+// kCallback 位，阻塞等待前置 kWaiting 位。谁后到谁负责调用回调或者唤醒对方，
+// 不需要互斥锁和条件变量。
+// 阻塞等待先自旋一段时间，再用 futex 睡眠；自旋的次数按线程自适应调整。
+//
+//   Promise<int> promise;
+//   Future<int> future = promise.GetFuture();
+//   std::thread([p = std::move(promise)]() mutable { p.SetValue(42); }).detach();
+//   Result<int> r = std::move(future).Get();
+//
+// Future 可以阻塞等待（Get）、登记回调（Then），也可以在协程里 co_await：
+// co_await future 在失败时让当前协程以同样的错误结束，co_await future.AsResult()
+// 则得到完整的 Result。
+
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "result.h"
+#include "spin_wait.h"
+
+// 在一个 32 位原子变量上睡眠和唤醒，Linux 下直接用 futex，其他平台用 C++20 的 atomic::wait
+class Futex {
+public:
+    static void Wait(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+                expected, nullptr, nullptr, 0);
+#else
+        word.wait(expected, std::memory_order_acquire);
+#endif
+    }
+
+    static void WakeAll(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+                INT32_MAX, nullptr, nullptr, 0);
+#else
+        word.notify_all();
+#endif
+    }
+};
+
+template <typename T, typename ErrorType>
+class FutureState {
+public:
+    enum : uint32_t {
+        kReady = 1,
+        kCallback = 2,
+        kWaiting = 4,
+    };
+
+    // 回调用函数指针加上下文表示，协程等待时不需要额外分配内存
+    using Callback = void (*)(void* context, FutureState* state);
+
+    void AddRef() {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    template <typename... Args>
+    void SetResult(Args&&... args) {
+        result_.emplace(std::forward<Args>(args)...);
+        uint32_t old = state_.fetch_or(kReady, std::memory_order_acq_rel);
+        if (old & kCallback) callback_(context_, this);
+        if (old & kWaiting) Futex::WakeAll(state_);
+    }
+
+    // 返回 false 表示结果已经就绪，回调不会被调用
+    bool TrySetCallback(Callback callback, void* context) {
+        callback_ = callback;
+        context_ = context;
+        uint32_t old = state_.fetch_or(kCallback, std::memory_order_acq_rel);
+        return (old & kReady) == 0;
+    }
+
+    bool IsReady() const {
+        return state_.load(std::memory_order_acquire) & kReady;
+    }
+
+    void Wait() {
+        if (AdaptiveSpin::SpinUntil([this] { return IsReady(); })) return;
+        uint32_t old = state_.fetch_or(kWaiting, std::memory_order_acquire) | kWaiting;
+        while ((old & kReady) == 0) {
+            Futex::Wait(state_, old);
+            old = state_.load(std::memory_order_acquire);
+        }
+    }
+
+    Result<T, ErrorType>& Get() {
+        return *result_;
+    }
+
+private:
+    std::atomic<uint32_t> state_{0};
+    std::atomic<int> refs_{1};  // Promise 和 Future 各持有一个
+    Callback callback_ = nullptr;
+    void* context_ = nullptr;
+    std::optional<Result<T, ErrorType>> result_;
+};
+
+template <typename T, typename ErrorType = GenericError>
+class Future;
+
+template <typename T, typename ErrorType = GenericError>
+class Promise {
+public:
+    Promise() : state_(new FutureState<T, ErrorType>) {}
+    Promise(Promise&& src) noexcept
+        : state_(std::exchange(src.state_, nullptr)), future_retrieved_(src.future_retrieved_) {}
+    Promise& operator=(Promise&& src) noexcept {
+        if (this != &src) {
+            Abandon();
+            state_ = std::exchange(src.state_, nullptr);
+            future_retrieved_ = src.future_retrieved_;
+        }
+        return *this;
+    }
+    ~Promise() {
+        Abandon();
+    }
+
+    // 只能调用一次
+    Future<T, ErrorType> GetFuture() {
+        future_retrieved_ = true;
+        state_->AddRef();
+        return Future<T, ErrorType>(state_);
+    }
+
+    // 以下几个函数只能调用其中一个，且只能调用一次
+    void SetResult(Result<T, ErrorType> result) {
+        Complete(std::move(result));
+    }
+
+    template <typename... Args>
+    void SetValue(Args&&... args) {
+        if constexpr (std::is_void_v<T>)
+            Complete();
+        else
+            Complete(T(std::forward<Args>(args)...));
+    }
+
+    void SetError(ErrorType error) {
+        Complete(std::move(error));
+    }
+
+private:
+    template <typename... Args>
+    void Complete(Args&&... args) {
+        auto* state = std::exchange(state_, nullptr);
+        state->SetResult(std::forward<Args>(args)...);
+        state->Release();
+    }
+
+    // 没有设置结果就销毁的 Promise 会让等待者永远等下去，
+    // 错误类型能用错误码构造时设置为 EPIPE，否则直接终止程序。
+    void Abandon() {
+        if (state_ == nullptr) return;
+        if (!future_retrieved_) {
+            std::exchange(state_, nullptr)->Release();
+            return;
+        }
+        if constexpr (std::is_constructible_v<ErrorType, int>) {
+            SetError(ErrorType(EPIPE));
+        } else {
+            std::fprintf(stderr, "Promise destroyed without setting a result\n");
+            std::abort();
+        }
+    }
+
+    FutureState<T, ErrorType>* state_;
+    bool future_retrieved_ = false;
+};
+
+template <typename T, typename ErrorType>
+class [[nodiscard]] Future {
+public:
+    Future() : state_(nullptr) {}
+    Future(Future&& src) noexcept : state_(std::exchange(src.state_, nullptr)) {}
+    Future& operator=(Future&& src) noexcept {
+        if (this != &src) {
+            if (state_) state_->Release();
+            state_ = std::exchange(src.state_, nullptr);
+        }
+        return *this;
+    }
+    ~Future() {
+        if (state_) state_->Release();
+    }
+
+    bool Valid() const {
+        return state_ != nullptr;
+    }
+
+    bool IsReady() const {
+        return state_->IsReady();
+    }
+
+    // 阻塞等待结果，之后 Future 不再有效
+    Result<T, ErrorType> Get() && {
+        state_->Wait();
+        Result<T, ErrorType> result(std::move(state_->Get()));
+        std::exchange(state_, nullptr)->Release();
+        return result;
+    }
+
+    // 登记回调，结果就绪时在设置结果的线程里以 Result<T, E>&& 调用；
+    // 如果已经就绪就在当前线程立即调用。之后 Future 不再有效。
+    template <typename Function>
+    void Then(Function function) && {
+        using State = FutureState<T, ErrorType>;
+        auto* holder = new Function(std::move(function));
+        State* state = std::exchange(state_, nullptr);
+        auto invoke = [](void* context, State* s) {
+            auto* f = static_cast<Function*>(context);
+            (*f)(std::move(s->Get()));
+            delete f;
+        };
+        if (!state->TrySetCallback(invoke, holder)) invoke(holder, state);
+        state->Release();
+    }
+
+    auto operator co_await() && {
+        return Awaiter<true>(std::move(*this));
+    }
+
+    auto AsResult() && {
+        return Awaiter<false>(std::move(*this));
+    }
+
+private:
+    friend class Promise<T, ErrorType>;
+    explicit Future(FutureState<T, ErrorType>* state) : state_(state) {}
+
+    template <bool kPropagate>
+    class Awaiter {
+    public:
+        explicit Awaiter(Future future) : future_(std::move(future)) {}
+
+        bool await_ready() const {
+            return !kPropagate && future_.IsReady();
+        }
+
+        // 传播错误需要在恢复前决定，所以传播模式下总是经过 await_suspend
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) {
+            auto* state = future_.state_;
+            auto resume = [](void* context, FutureState<T, ErrorType>* s) {
+                Resume(std::coroutine_handle<Promise>::from_address(context), s).resume();
+            };
+            if (state->TrySetCallback(resume, handle.address()))
+                return std::noop_coroutine();
+            return Resume(handle, state);
+        }
+
+        decltype(auto) await_resume() {
+            auto& result = future_.state_->Get();
+            if constexpr (!kPropagate) {
+                return Result<T, ErrorType>(std::move(result));
+            } else if constexpr (!std::is_void_v<T>) {
+                return T(std::move(result.Value()));
+            }
+        }
+
+    private:
+        template <typename Promise>
+        static std::coroutine_handle<> Resume(std::coroutine_handle<Promise> handle,
+                                              FutureState<T, ErrorType>* state) {
+            if (kPropagate && !state->Get().OK())
+                return handle.promise().ReturnError(handle, state->Get().Error());
+            return handle;
+        }
+
+        Future future_;
+    };
+
+    FutureState<T, ErrorType>* state_;
+};
+
+#endif // ERROR_HANDLING_FUTURE_H_
@@ -0,0 +1,102 @@
+#ifndef ERROR_HANDLING_LINE_READER_H_
+#define ERROR_HANDLING_LINE_READER_H_
+
+// 从文件描述符流式地逐行读取，适合不能一次读进内存的大输入：
+//
+//   LineReader reader(fd);
+//   while (auto line = reader.Next()) {
+//       if (!line->OK()) return line->Error();   // read 失败，错误码是 errno
+//       Process(line->Value());                  // 不含行尾的 '\n'
+//   }
+//
+// 所有的行都放在同一块可增长的缓冲区里，返回的 string_view 直接指向缓冲区，
+// 每行没有额外的内存分配。一行跨越两次 read 时，把未处理完的部分移到缓冲区开头
+// 再继续读；一行比缓冲区还长时缓冲区加倍。返回的行只在下次调用 Next 之前有效。
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "errno_error.h"
+#include "result.h"
+
+class LineReader {
+public:
+    // 不接管 fd，用完后由调用者关闭
+    explicit LineReader(int fd, std::size_t initial_capacity = 64 * 1024)
+        : fd_(fd), capacity_(initial_capacity < 16 ? 16 : initial_capacity),
+          buffer_(new char[capacity_]) {}
+
+    LineReader(const LineReader&) = delete;
+    LineReader& operator=(const LineReader&) = delete;
+
+    // 返回下一行，读完时返回 std::nullopt。文件最后一行没有 '\n' 时也会返回。
+    // read 失败时返回 IoError，之后可以再次调用 Next 重试。
+    std::optional<Result<std::string_view, IoError>> Next() {
+        for (;;) {
+            // scan_ 之前的部分已经找过了，不再重复查找
+            if (const void* nl = std::memchr(buffer_.get() + scan_, '\n', end_ - scan_)) {
+                std::size_t pos = static_cast<const char*>(nl) - buffer_.get();
+                std::string_view line(buffer_.get() + begin_, pos - begin_);
+                begin_ = scan_ = pos + 1;
+                return Result<std::string_view, IoError>(line);
+            }
+            scan_ = end_;
+            if (eof_) {
+                if (begin_ == end_) return std::nullopt;
+                std::string_view line(buffer_.get() + begin_, end_ - begin_);
+                begin_ = scan_ = end_;
+                return Result<std::string_view, IoError>(line);
+            }
+            auto filled = Fill();
+            if (!filled.OK()) return Result<std::string_view, IoError>(filled.Error());
+        }
+    }
+
+    // 目前缓冲区的大小，取决于最长的行
+    std::size_t Capacity() const {
+        return capacity_;
+    }
+
+private:
+    // 把未处理的数据移到缓冲区开头，必要时扩大缓冲区，再读一次
+    Result<void, IoError> Fill() {
+        if (begin_ != 0) {
+            std::memmove(buffer_.get(), buffer_.get() + begin_, end_ - begin_);
+            end_ -= begin_;
+            scan_ -= begin_;
+            begin_ = 0;
+        }
+        if (end_ == capacity_) {
+            std::unique_ptr<char[]> bigger(new char[capacity_ * 2]);
+            std::memcpy(bigger.get(), buffer_.get(), end_);
+            buffer_ = std::move(bigger);
+            capacity_ *= 2;
+        }
+        ssize_t n;
+        do {
+            n = ::read(fd_, buffer_.get() + end_, capacity_ - end_);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) return IoError(ErrnoType(errno));
+        if (n == 0)
+            eof_ = true;
+        else
+            end_ += n;
+        return Result<void, IoError>();
+    }
+
+    int fd_;
+    std::size_t capacity_;
+    std::unique_ptr<char[]> buffer_;
+    std::size_t begin_ = 0;  // 下一行的开始
+    std::size_t scan_ = 0;   // 从这里开始查找 '\n'
+    std::size_t end_ = 0;    // 有效数据的结尾
+    bool eof_ = false;
+};
+
+#endif // ERROR_HANDLING_LINE_READER_H_
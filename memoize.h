@@ -0,0 +1,316 @@
+#ifndef ERROR_HANDLING_MEMOIZE_H_
+#define ERROR_HANDLING_MEMOIZE_H_
+
+// 缓存返回 Result 的函数的结果，失败和成功一样可以缓存：
+//
+//   auto get_int = Memoize<std::string>(GetIntFromFile, {.ttl = std::chrono::minutes(1),
+//                                                        .error_ttl = std::chrono::seconds(1)});
+//   Result<int> n = get_int("number");   // 第一次调用 GetIntFromFile，之后直接返回缓存
+//
+// 缓存分成若干个分片，每个分片有自己的锁和哈希表，减少线程间的竞争。成功和失败的结果
+// 分别有各自的 TTL 和容量，容量用满时按 CLOCK 算法（近似 LRU）淘汰：每个条目有一个
+// 访问位，淘汰时指针扫过的条目如果最近被访问过就清掉访问位跳过，否则淘汰，过期的条目
+// 优先淘汰。多个线程同时对同一个键未命中时，只有一个线程调用函数，其他线程等待它的结果。
+// 调用的函数抛出异常时，异常只传给调用它的线程，等待的线程醒来后重新计算。
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "result.h"
+
+struct MemoizeOptions {
+    std::size_t shards = 16;  // 超过容量时减少到容量
+    std::size_t capacity = 4096;  // 成功结果的总容量
+    std::chrono::steady_clock::duration ttl = std::chrono::steady_clock::duration::max();
+    std::size_t error_capacity = 1024;  // 失败结果的总容量，为 0 时不缓存失败
+    std::chrono::steady_clock::duration error_ttl = std::chrono::seconds(1);
+};
+
+struct MemoizeStats {
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> error_hits{0};  // 命中的是缓存的失败结果，也计入 hits
+    std::atomic<uint64_t> misses{0};      // 调用函数的次数
+    std::atomic<uint64_t> coalesced{0};   // 等待了其他线程的调用而没有自己调用的次数
+    std::atomic<uint64_t> evictions{0};
+};
+
+template <typename Key, typename T, typename ErrorType = GenericError, typename Hash = std::hash<Key>>
+class MemoCache {
+public:
+    using ResultType = Result<T, ErrorType>;
+    using Clock = std::chrono::steady_clock;
+
+    explicit MemoCache(MemoizeOptions options = {}) : options_(options), shards_(ShardCount(options)) {
+        const std::size_t n = shards_.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            shards_[i].values.capacity = options_.capacity / n + (i < options_.capacity % n);
+            shards_[i].errors.capacity = options_.error_capacity / n + (i < options_.error_capacity % n);
+        }
+    }
+
+    MemoCache(const MemoCache&) = delete;
+    MemoCache& operator=(const MemoCache&) = delete;
+
+    // 返回 key 对应的结果，缓存中没有或已经过期时调用 compute(key) 计算并缓存
+    template <typename Function>
+    ResultType GetOrCompute(const Key& key, Function&& compute) {
+        Shard& shard = ShardFor(key);
+        std::shared_ptr<Flight> flight;
+        {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            const auto now = Clock::now();
+            auto it = shard.map.find(key);
+            if (it != shard.map.end()) {
+                Entry& entry = it->second;
+                if (entry.expiry > now) {
+                    entry.referenced = true;
+                    stats_.hits.fetch_add(1, std::memory_order_relaxed);
+                    if (entry.error) stats_.error_hits.fetch_add(1, std::memory_order_relaxed);
+                    return entry.result;
+                }
+                Remove(shard, it);
+            }
+            auto flying = shard.flights.find(key);
+            if (flying != shard.flights.end()) {
+                std::shared_ptr<Flight> other = flying->second;
+                lock.unlock();
+                stats_.coalesced.fetch_add(1, std::memory_order_relaxed);
+                std::optional<ResultType> result = other->Wait();
+                if (result) return std::move(*result);
+                // 计算的线程抛出了异常，重新查找，由等待的线程之一重新计算
+                return GetOrCompute(key, compute);
+            }
+            flight = std::make_shared<Flight>();
+            shard.flights.emplace(key, flight);
+        }
+
+        stats_.misses.fetch_add(1, std::memory_order_relaxed);
+        AbandonOnUnwind guard{shard, key, flight.get()};
+        ResultType result = compute(key);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.flights.erase(key);
+            Insert(shard, key, result, Clock::now());
+        }
+        guard.flight = nullptr;
+        flight->Publish(result);
+        return result;
+    }
+
+    void Erase(const Key& key) {
+        Shard& shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.find(key);
+        if (it != shard.map.end()) Remove(shard, it);
+    }
+
+    void Clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.map.clear();
+            shard.values.slots.clear();
+            shard.errors.slots.clear();
+            shard.values.hand = shard.errors.hand = 0;
+        }
+    }
+
+    // 目前缓存的条目数，包括已经过期但还没有被清除的
+    std::size_t Size() const {
+        std::size_t size = 0;
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            size += shard.map.size();
+        }
+        return size;
+    }
+
+    const MemoizeStats& Stats() const {
+        return stats_;
+    }
+
+private:
+    struct Entry {
+        ResultType result;
+        Clock::time_point expiry;
+        bool error;
+        bool referenced = false;
+        std::size_t slot = 0;  // 在所属 ClockRing 里的位置
+    };
+
+    using Map = std::unordered_map<Key, Entry, Hash>;
+
+    // CLOCK 淘汰用的环，保存条目的键的指针，unordered_map 的节点地址是稳定的
+    struct ClockRing {
+        std::vector<const Key*> slots;
+        std::size_t hand = 0;
+        std::size_t capacity = 0;
+    };
+
+    // 正在计算中的键，同时未命中的其他线程在这里等待
+    struct Flight {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::optional<ResultType> result;
+        bool abandoned = false;  // 计算的函数抛出了异常，不会有结果
+
+        void Publish(const ResultType& r) {
+            std::lock_guard<std::mutex> lock(mutex);
+            result.emplace(r);
+            cv.notify_all();
+        }
+        void Abandon() {
+            std::lock_guard<std::mutex> lock(mutex);
+            abandoned = true;
+            cv.notify_all();
+        }
+        // 放弃的计算返回空
+        std::optional<ResultType> Wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return result.has_value() || abandoned; });
+            return result;
+        }
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        Map map;
+        ClockRing values;
+        ClockRing errors;
+        std::unordered_map<Key, std::shared_ptr<Flight>, Hash> flights;
+    };
+
+    // compute 抛出异常时删除 flight 并唤醒等待的线程，否则它们会一直等下去
+    struct AbandonOnUnwind {
+        Shard& shard;
+        const Key& key;
+        Flight* flight;
+
+        ~AbandonOnUnwind() {
+            if (flight == nullptr) return;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.flights.erase(key);
+            }
+            flight->Abandon();
+        }
+    };
+
+    // 分片数不超过容量，每个分片至少能存一个结果，容量按分片分配后总数不会超过设定的值
+    static std::size_t ShardCount(const MemoizeOptions& options) {
+        std::size_t n = options.shards;
+        if (options.capacity < n) n = options.capacity;
+        if (options.error_capacity != 0 && options.error_capacity < n) n = options.error_capacity;
+        return n == 0 ? 1 : n;
+    }
+
+    Shard& ShardFor(const Key& key) {
+        std::size_t h = Hash()(key);
+        // std::hash 对整数是恒等映射，混合一下高位再取模
+        h ^= h >> 29;
+        h *= 0x9E3779B97F4A7C15ull;
+        return shards_[(h >> 32) % shards_.size()];
+    }
+
+    static Clock::time_point ExpiryAfter(Clock::time_point now, Clock::duration ttl) {
+        if (ttl >= Clock::time_point::max() - now) return Clock::time_point::max();
+        return now + ttl;
+    }
+
+    void Insert(Shard& shard, const Key& key, const ResultType& result, Clock::time_point now) {
+        const bool error = !result.OK();
+        ClockRing& ring = error ? shard.errors : shard.values;
+        if (ring.capacity == 0) return;
+        // 同一个键同时只有一个线程在计算，这里通常没有旧条目，保险起见先删除
+        auto old = shard.map.find(key);
+        if (old != shard.map.end()) Remove(shard, old);
+
+        std::size_t slot;
+        if (ring.slots.size() < ring.capacity) {
+            slot = ring.slots.size();
+            ring.slots.push_back(nullptr);
+        } else {
+            slot = EvictOne(shard, ring, now);
+        }
+        auto it = shard.map.emplace(key, Entry{result, ExpiryAfter(now, error ? options_.error_ttl : options_.ttl),
+                                               error, false, slot}).first;
+        ring.slots[slot] = &it->first;
+    }
+
+    // 环满时转动指针找到一个可以淘汰的条目，返回空出来的位置
+    std::size_t EvictOne(Shard& shard, ClockRing& ring, Clock::time_point now) {
+        for (;;) {
+            std::size_t slot = ring.hand;
+            ring.hand = (ring.hand + 1) % ring.slots.size();
+            auto it = shard.map.find(*ring.slots[slot]);
+            Entry& entry = it->second;
+            if (entry.referenced && entry.expiry > now) {
+                entry.referenced = false;
+                continue;
+            }
+            shard.map.erase(it);
+            stats_.evictions.fetch_add(1, std::memory_order_relaxed);
+            return slot;
+        }
+    }
+
+    // 删除一个条目，用环的最后一项填补它的位置
+    void Remove(Shard& shard, typename Map::iterator it) {
+        ClockRing& ring = it->second.error ? shard.errors : shard.values;
+        const std::size_t slot = it->second.slot;
+        const std::size_t last = ring.slots.size() - 1;
+        if (slot != last) {
+            ring.slots[slot] = ring.slots[last];
+            shard.map.find(*ring.slots[slot])->second.slot = slot;
+        }
+        ring.slots.pop_back();
+        if (ring.hand >= ring.slots.size()) ring.hand = 0;
+        shard.map.erase(it);
+    }
+
+    const MemoizeOptions options_;
+    std::vector<Shard> shards_;
+    MemoizeStats stats_;
+};
+
+// 带缓存的函数对象，以 const Key& 调用
+template <typename Key, typename Function>
+class Memoized {
+public:
+    using ResultType = std::invoke_result_t<const Function&, const Key&>;
+    using Cache = MemoCache<Key, typename ResultTraits<ResultType>::ValueType,
+                            typename ResultTraits<ResultType>::Error>;
+
+    Memoized(Function function, MemoizeOptions options)
+        : function_(std::move(function)), cache_(std::make_unique<Cache>(options)) {}
+
+    ResultType operator()(const Key& key) const {
+        return cache_->GetOrCompute(key, function_);
+    }
+
+    Cache& GetCache() const {
+        return *cache_;
+    }
+
+private:
+    Function function_;
+    std::unique_ptr<Cache> cache_;  // 放在堆上，使 Memoized 可以移动
+};
+
+// Key 需要显式指定，比如 Memoize<std::string>(GetIntFromFile)
+template <typename Key, typename Function>
+Memoized<Key, std::decay_t<Function>> Memoize(Function&& function, MemoizeOptions options = {}) {
+    return Memoized<Key, std::decay_t<Function>>(std::forward<Function>(function), options);
+}
+
+#endif // ERROR_HANDLING_MEMOIZE_H_
@@ -0,0 +1,192 @@
+#ifndef ERROR_HANDLING_MPMC_QUEUE_H_
+#define ERROR_HANDLING_MPMC_QUEUE_H_
+
+// 有界的多生产者多消费者无锁环形队列，元素是 Result<T, E>，用于多级流水线：
+// 每一级对每个元素都可能失败，错误和值一样沿着队列往下游传。
+//
+// 队列满时 TryPush 不阻塞，而是返回 QueueError(kFull)，生产者可以据此丢弃负载
+// 或者稍后重试。算法参见 Dmitry Vyukov 的 bounded MPMC queue：每个槽位有一个
+// 序号，生产者和消费者各自用 CAS 争抢位置，槽位本身不需要锁。
+// 批量操作一次 CAS 占用多个连续位置，摊薄争用。
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "result.h"
+#include "spin_wait.h"
+
+enum class QueueErrorCode {
+    kFull = 1,
+};
+
+using QueueError = TypedError<QueueErrorCode>;
+
+template <typename T, typename ErrorType = GenericError>
+class MpmcQueue {
+public:
+    using Item = Result<T, ErrorType>;
+
+    // capacity 必须是 2 的幂
+    explicit MpmcQueue(std::size_t capacity)
+        : mask_(capacity - 1), slots_(new Slot[capacity]) {
+        assert(capacity >= 2 && (capacity & mask_) == 0);
+        for (std::size_t i = 0; i < capacity; ++i)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    ~MpmcQueue() {
+        while (TryPop()) {}
+    }
+
+    std::size_t Capacity() const {
+        return mask_ + 1;
+    }
+
+    // 近似的元素个数，并发修改时只能作参考
+    std::size_t SizeApprox() const {
+        std::size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+        std::size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    Result<void, QueueError> TryPush(Item item) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.Construct(std::move(item));
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return {};
+                }
+            } else if (diff < 0) {
+                return QueueError(QueueErrorCode::kFull);
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 队列为空时返回 std::nullopt
+    std::optional<Item> TryPop() {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<Item> item(slot.Take());
+                    slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return item;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 把 items[0, n) 中尽可能多的元素移入队列，返回移入的个数。
+    // 一个都放不下时返回 QueueError(kFull)。
+    Result<std::size_t, QueueError> TryPushBatch(Item* items, std::size_t n) {
+        if (n == 0) return std::size_t(0);
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        std::size_t count;
+        for (;;) {
+            std::size_t head = dequeue_pos_.load(std::memory_order_acquire);
+            std::size_t used = pos - head;
+            if (used >= Capacity()) {
+                // pos 可能已经过时，重新读一次再判断
+                std::size_t current = enqueue_pos_.load(std::memory_order_relaxed);
+                if (current == pos) return QueueError(QueueErrorCode::kFull);
+                pos = current;
+                continue;
+            }
+            count = std::min(n, Capacity() - used);
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                break;
+        }
+        // 占到的位置已经被消费者认领，但消费者可能还没读完，等它们腾出来
+        for (std::size_t i = 0; i < count; ++i) {
+            Slot& slot = slots_[(pos + i) & mask_];
+            WaitSequence(slot, pos + i);
+            slot.Construct(std::move(items[i]));
+            slot.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // 最多取出 max 个元素，依次传给 sink，返回取出的个数
+    template <typename Sink>
+    std::size_t TryPopBatch(std::size_t max, Sink sink) {
+        if (max == 0) return 0;
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        std::size_t count;
+        for (;;) {
+            std::size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+            if (tail == pos) {
+                std::size_t current = dequeue_pos_.load(std::memory_order_relaxed);
+                if (current == pos) return 0;
+                pos = current;
+                continue;
+            }
+            count = std::min(max, tail - pos);
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                break;
+        }
+        // 占到的位置已经被生产者认领，但生产者可能还没写完
+        for (std::size_t i = 0; i < count; ++i) {
+            Slot& slot = slots_[(pos + i) & mask_];
+            WaitSequence(slot, pos + i + 1);
+            sink(slot.Take());
+            slot.sequence.store(pos + i + mask_ + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        alignas(Item) unsigned char storage[sizeof(Item)];
+
+        void Construct(Item&& item) {
+            new (storage) Item(std::move(item));
+        }
+        Item Take() {
+            Item* p = std::launder(reinterpret_cast<Item*>(storage));
+            Item item(std::move(*p));
+            p->~Item();
+            return item;
+        }
+    };
+
+    static void WaitSequence(const Slot& slot, std::size_t expected) {
+        for (int spins = 0; slot.sequence.load(std::memory_order_acquire) != expected; ++spins) {
+            if (spins < 64)
+                CpuRelax();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+#endif // ERROR_HANDLING_MPMC_QUEUE_H_
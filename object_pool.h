@@ -0,0 +1,295 @@
+#ifndef ERROR_HANDLING_OBJECT_POOL_H_
+#define ERROR_HANDLING_OBJECT_POOL_H_
+
+// 固定容量的无锁对象池，用于连接、缓冲区等创建代价高的对象：
+//
+//   ObjectPool<Buffer> pool(256, buffer_size);   // 预先构造 256 个 Buffer(buffer_size)
+//   Result<Pooled<Buffer>, PoolError> buffer = pool.Acquire();
+//   if (!buffer.OK()) ...                         // 池已耗尽，不阻塞也不抛异常
+//   buffer.Value()->Write(...);                   // Pooled 析构时自动归还
+//
+// 空闲对象的下标放在一个全局的无锁栈（Treiber stack）里，栈顶带版本号防止 ABA，
+// 链表可以一次 CAS 整段取出或放回。另外还有若干个线程缓存，每个线程固定使用其中一个，
+// 大部分的 Acquire 和归还只碰自己的缓存，不用访问共享的栈顶；缓存空了从栈里批量取，
+// 满了批量放回一半。缓存用一个原子标志占用，两个线程映射到同一个缓存时后来的直接用全局栈，
+// 不会等待。全局栈空了还会从其他线程的缓存里取；只有正被其他线程占用的缓存里的对象取不到，
+// 所以剩下的空闲对象很少时，Acquire 偶尔会在还有空闲对象的情况下报告耗尽。
+//
+// 对象在池的生命期内一直存在，归还时不会重置状态。所有的 Pooled 都要在池析构之前归还。
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "result.h"
+
+enum class PoolErrorCode {
+    kExhausted = 1,
+};
+
+using PoolError = TypedError<PoolErrorCode>;
+
+template <typename T>
+class ObjectPool;
+
+// 从池里借出的对象，析构时归还
+template <typename T>
+class Pooled {
+public:
+    Pooled() {}
+    Pooled(Pooled&& src) noexcept
+        : pool_(std::exchange(src.pool_, nullptr)), index_(src.index_) {}
+    Pooled& operator=(Pooled&& src) noexcept {
+        if (this != &src) {
+            Reset();
+            pool_ = std::exchange(src.pool_, nullptr);
+            index_ = src.index_;
+        }
+        return *this;
+    }
+    Pooled(const Pooled&) = delete;
+    Pooled& operator=(const Pooled&) = delete;
+
+    ~Pooled() {
+        Reset();
+    }
+
+    T* Get() const {
+        return pool_->Object(index_);
+    }
+    T* operator->() const {
+        return Get();
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    explicit operator bool() const {
+        return pool_ != nullptr;
+    }
+
+    // 提前归还
+    void Reset() {
+        if (pool_ != nullptr) std::exchange(pool_, nullptr)->Release(index_);
+    }
+
+private:
+    friend class ObjectPool<T>;
+    Pooled(ObjectPool<T>* pool, uint32_t index) : pool_(pool), index_(index) {}
+
+    ObjectPool<T>* pool_ = nullptr;
+    uint32_t index_ = 0;
+};
+
+namespace object_pool_internal {
+
+// 每个线程一个固定的编号，用来选择线程缓存
+inline uint32_t ThreadSlot() {
+    static std::atomic<uint32_t> next{0};
+    static thread_local const uint32_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+} // namespace object_pool_internal
+
+struct ObjectPoolOptions {
+    std::size_t thread_caches = 0;  // 线程缓存的个数，0 表示 CPU 数的两倍
+    std::size_t cache_size = 16;    // 每个线程缓存最多存放的空闲对象个数，0 表示不用线程缓存
+};
+
+template <typename T>
+class ObjectPool {
+public:
+    // 以 args 构造 capacity 个对象
+    template <typename... Args>
+    explicit ObjectPool(std::size_t capacity, const Args&... args)
+        : ObjectPool(ObjectPoolOptions{}, capacity, args...) {}
+
+    template <typename... Args>
+    ObjectPool(ObjectPoolOptions options, std::size_t capacity, const Args&... args)
+        : capacity_(capacity),
+          cache_size_(std::min<std::size_t>(options.cache_size, Cache::kMaxSize)),
+          objects_(static_cast<Storage*>(::operator new(sizeof(Storage) * capacity))),
+          next_(new std::atomic<uint32_t>[capacity]) {
+        assert(capacity < kNil);
+        for (std::size_t i = 0; i < capacity; ++i) {
+            new (&objects_[i]) T(args...);
+            next_[i].store(i + 1 < capacity ? i + 1 : kNil, std::memory_order_relaxed);
+        }
+        head_.store(Pack(0, capacity == 0 ? kNil : 0), std::memory_order_relaxed);
+
+        std::size_t caches = options.thread_caches;
+        if (caches == 0) caches = 2 * std::max(1u, std::thread::hardware_concurrency());
+        cache_count_ = 1;
+        while (cache_count_ < caches) cache_count_ *= 2;
+        caches_.reset(new Cache[cache_count_]);
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() {
+        for (std::size_t i = 0; i < capacity_; ++i) Object(i)->~T();
+        ::operator delete(objects_);
+    }
+
+    std::size_t Capacity() const {
+        return capacity_;
+    }
+
+    // 借出一个空闲对象，池已耗尽时返回 PoolError(kExhausted)
+    Result<Pooled<T>, PoolError> Acquire() {
+        uint32_t index = kNil;
+        if (cache_size_ != 0) {
+            Cache& cache = CacheForThisThread();
+            if (cache.TryLock()) {
+                if (cache.count == 0) Refill(cache);
+                if (cache.count != 0) index = cache.items[--cache.count];
+                cache.Unlock();
+            }
+        }
+        if (index == kNil) index = PopChain(1).first;
+        if (index == kNil) index = Steal();
+        if (index == kNil) return ExhaustedError();
+        return Pooled<T>(this, index);
+    }
+
+private:
+    friend class Pooled<T>;
+
+    using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    struct alignas(64) Cache {
+        static constexpr std::size_t kMaxSize = 64;
+
+        std::atomic<bool> busy{false};
+        uint32_t count = 0;
+        uint32_t items[kMaxSize];
+
+        bool TryLock() {
+            return !busy.load(std::memory_order_relaxed) && !busy.exchange(true, std::memory_order_acquire);
+        }
+        void Unlock() {
+            busy.store(false, std::memory_order_release);
+        }
+    };
+
+    // 耗尽是常见的情况，共用一个错误对象，不用每次分配
+    static const PoolError& ExhaustedError() {
+        static const PoolError error(PoolErrorCode::kExhausted);
+        return error;
+    }
+
+    static uint64_t Pack(uint32_t tag, uint32_t index) {
+        return static_cast<uint64_t>(tag) << 32 | index;
+    }
+    static uint32_t Tag(uint64_t head) {
+        return static_cast<uint32_t>(head >> 32);
+    }
+    static uint32_t Index(uint64_t head) {
+        return static_cast<uint32_t>(head);
+    }
+
+    T* Object(std::size_t index) const {
+        return std::launder(reinterpret_cast<T*>(&objects_[index]));
+    }
+
+    Cache& CacheForThisThread() {
+        return caches_[object_pool_internal::ThreadSlot() & (cache_count_ - 1)];
+    }
+
+    void Release(uint32_t index) {
+        if (cache_size_ != 0) {
+            Cache& cache = CacheForThisThread();
+            if (cache.TryLock()) {
+                if (cache.count == cache_size_) Flush(cache, cache_size_ / 2 + 1);
+                cache.items[cache.count++] = index;
+                cache.Unlock();
+                return;
+            }
+        }
+        next_[index].store(kNil, std::memory_order_relaxed);
+        PushChain(index, index);
+    }
+
+    // 从全局栈一次取出最多 n 个，返回链表的头和个数，链表以 next_ 相连
+    std::pair<uint32_t, std::size_t> PopChain(std::size_t n) {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        for (;;) {
+            const uint32_t first = Index(head);
+            if (first == kNil) return {kNil, 0};
+            // 其他线程可能同时取走了这些节点，这时读到的 next 是过时的，但 CAS 一定失败
+            uint32_t last = first;
+            std::size_t count = 1;
+            for (uint32_t next; count < n && (next = next_[last].load(std::memory_order_relaxed)) != kNil; ++count)
+                last = next;
+            const uint32_t rest = next_[last].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, Pack(Tag(head) + 1, rest), std::memory_order_acquire,
+                                            std::memory_order_acquire))
+                return {first, count};
+        }
+    }
+
+    // 把以 next_ 相连的 first..last 整段放回全局栈
+    void PushChain(uint32_t first, uint32_t last) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        do {
+            next_[last].store(Index(head), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, Pack(Tag(head) + 1, first), std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    // 缓存空了，从全局栈取一半缓存大小的对象
+    void Refill(Cache& cache) {
+        auto [index, count] = PopChain(cache_size_ / 2 + 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            cache.items[cache.count++] = index;
+            index = next_[index].load(std::memory_order_relaxed);
+        }
+    }
+
+    // 把缓存里的 n 个对象放回全局栈
+    void Flush(Cache& cache, std::size_t n) {
+        if (n == 0) return;
+        const uint32_t first = cache.items[cache.count - 1];
+        uint32_t last = first;
+        for (std::size_t i = 1; i < n; ++i) {
+            const uint32_t index = cache.items[cache.count - 1 - i];
+            next_[last].store(index, std::memory_order_relaxed);
+            last = index;
+        }
+        cache.count -= n;
+        PushChain(first, last);
+    }
+
+    // 全局栈已空，从其他线程的缓存里取
+    uint32_t Steal() {
+        if (cache_size_ == 0) return kNil;
+        for (std::size_t i = 0; i < cache_count_; ++i) {
+            Cache& cache = caches_[i];
+            if (!cache.TryLock()) continue;
+            uint32_t index = kNil;
+            if (cache.count != 0) index = cache.items[--cache.count];
+            cache.Unlock();
+            if (index != kNil) return index;
+        }
+        return kNil;
+    }
+
+    const std::size_t capacity_;
+    const std::size_t cache_size_;
+    Storage* const objects_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    std::size_t cache_count_;
+    std::unique_ptr<Cache[]> caches_;
+    alignas(64) std::atomic<uint64_t> head_;
+};
+
+#endif // ERROR_HANDLING_OBJECT_POOL_H_
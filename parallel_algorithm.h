@@ -0,0 +1,199 @@
+#ifndef ERROR_HANDLING_PARALLEL_ALGORITHM_H_
+#define ERROR_HANDLING_PARALLEL_ALGORITHM_H_
+
+// 感知 Result 的并行算法：
+//
+//   Result<std::vector<int>> values = TryTransform(pool, strings, ParseInt);
+//   Result<long> sum = TryReduce(pool, strings, 0L, ParseInt, std::plus<long>());
+//
+// 输入被分成若干块，按顺序分给线程池里的线程和调用者自己。某个元素出错后，
+// 位于它之后的块不再处理，块内也在越过这个位置后停止；它之前的块仍然会处理完，
+// 所以返回的总是下标最小的那个错误，结果是确定的，和线程的调度无关。
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "result.h"
+#include "task.h"
+#include "thread_pool.h"
+
+// 并行地处理 [0, n) 上的各个块，调用者也参与处理，直到所有的块都处理完才返回。
+// 没抢到块的辅助线程在调用者返回后才开始运行也没关系，它们只访问共享的计数器。
+class ParallelChunks {
+public:
+    template <typename Process>
+    static void Run(ThreadPool& pool, std::size_t num_chunks, Process process) {
+        if (num_chunks == 0) return;
+        auto state = std::make_shared<State>();
+        state->num_chunks = num_chunks;
+        state->process = std::ref(process);
+        const int helpers = static_cast<int>(std::min<std::size_t>(pool.Size(), num_chunks - 1));
+        for (int i = 0; i < helpers; ++i) Help(pool, state);
+        Work(*state);
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&] {
+            return state->finished.load(std::memory_order_acquire) == num_chunks;
+        });
+    }
+
+private:
+    struct State {
+        std::size_t num_chunks = 0;
+        std::function<void(std::size_t)> process;
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> finished{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    static void Work(State& state) {
+        for (;;) {
+            std::size_t chunk = state.next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= state.num_chunks) return;
+            state.process(chunk);
+            if (state.finished.fetch_add(1, std::memory_order_acq_rel) + 1 == state.num_chunks) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.cv.notify_one();
+            }
+        }
+    }
+
+    static DetachedTask Help(ThreadPool& pool, std::shared_ptr<State> state) {
+        co_await pool.Schedule();
+        Work(*state);
+    }
+};
+
+// 记录下标最小的错误位置
+class FirstErrorIndex {
+public:
+    static constexpr std::size_t kNone = std::numeric_limits<std::size_t>::max();
+
+    std::size_t Get() const {
+        return index_.load(std::memory_order_relaxed);
+    }
+
+    void Update(std::size_t index) {
+        std::size_t current = index_.load(std::memory_order_relaxed);
+        while (index < current &&
+               !index_.compare_exchange_weak(current, index, std::memory_order_relaxed)) {
+        }
+    }
+
+private:
+    std::atomic<std::size_t> index_{kNone};
+};
+
+inline std::size_t ParallelGrainSize(std::size_t n, const ThreadPool& pool, std::size_t grain) {
+    if (grain != 0) return grain;
+    // 每个线程大约分到 8 块，便于负载均衡，但块也不能太小
+    return std::max<std::size_t>(1024, n / (8 * (pool.Size() + 1)));
+}
+
+// 对 range 的每个元素调用 function（返回 Result<T, E>），全部成功时得到所有的值，
+// 否则得到下标最小的错误。grain 为 0 时自动选择块的大小。
+template <typename Range, typename Function>
+auto TryTransform(ThreadPool& pool, const Range& range, Function function, std::size_t grain = 0) {
+    using Element = decltype(*std::begin(range));
+    using ItemResult = std::invoke_result_t<Function&, Element>;
+    using T = typename ResultTraits<ItemResult>::ValueType;
+    using ErrorType = typename ResultTraits<ItemResult>::Error;
+    // 能默认构造的类型直接写到结果里，否则先放到 optional 里再搬过去。
+    // vector<bool> 按位存放，不同的块会写同一个字，bool 也要先放到 optional 里
+    using Slot = std::conditional_t<std::is_default_constructible_v<T> && !std::is_same_v<T, bool>, T,
+                                    std::optional<T>>;
+
+    const auto first = std::begin(range);
+    const std::size_t n = std::size(range);
+    grain = ParallelGrainSize(n, pool, grain);
+    const std::size_t num_chunks = (n + grain - 1) / grain;
+
+    std::vector<Slot> slots(n);
+    std::vector<std::optional<ErrorType>> chunk_errors(num_chunks);
+    FirstErrorIndex first_error;
+
+    ParallelChunks::Run(pool, num_chunks, [&](std::size_t chunk) {
+        const std::size_t begin = chunk * grain;
+        const std::size_t end = std::min(n, begin + grain);
+        for (std::size_t i = begin; i < end && i < first_error.Get(); ++i) {
+            ItemResult result = function(first[i]);
+            if (!result.OK()) {
+                chunk_errors[chunk].emplace(result.Error());
+                first_error.Update(i);
+                return;
+            }
+            slots[i] = std::move(result.Value());
+        }
+    });
+
+    using Output = Result<std::vector<T>, ErrorType>;
+    if (first_error.Get() != FirstErrorIndex::kNone)
+        return Output(std::move(*chunk_errors[first_error.Get() / grain]));
+    if constexpr (std::is_same_v<Slot, T>) {
+        return Output(std::move(slots));
+    } else {
+        std::vector<T> values;
+        values.reserve(n);
+        for (auto& slot : slots) values.push_back(std::move(*slot));
+        return Output(std::move(values));
+    }
+}
+
+// 对 range 的每个元素调用 map（返回 Result<T, E>），再用 reduce 把所有的值依次归约到
+// init 上。reduce 需要满足结合律，各块的部分结果按块的顺序合并，所以不要求交换律。
+template <typename Range, typename T, typename MapFunction, typename ReduceFunction>
+auto TryReduce(ThreadPool& pool, const Range& range, T init, MapFunction map,
+               ReduceFunction reduce, std::size_t grain = 0) {
+    using Element = decltype(*std::begin(range));
+    using ItemResult = std::invoke_result_t<MapFunction&, Element>;
+    using ErrorType = typename ResultTraits<ItemResult>::Error;
+
+    const auto first = std::begin(range);
+    const std::size_t n = std::size(range);
+    grain = ParallelGrainSize(n, pool, grain);
+    const std::size_t num_chunks = (n + grain - 1) / grain;
+
+    std::vector<std::optional<T>> partials(num_chunks);
+    std::vector<std::optional<ErrorType>> chunk_errors(num_chunks);
+    FirstErrorIndex first_error;
+
+    ParallelChunks::Run(pool, num_chunks, [&](std::size_t chunk) {
+        const std::size_t begin = chunk * grain;
+        const std::size_t end = std::min(n, begin + grain);
+        std::optional<T> partial;
+        for (std::size_t i = begin; i < end && i < first_error.Get(); ++i) {
+            ItemResult result = map(first[i]);
+            if (!result.OK()) {
+                chunk_errors[chunk].emplace(result.Error());
+                first_error.Update(i);
+                return;
+            }
+            if (partial)
+                partial.emplace(reduce(std::move(*partial), std::move(result.Value())));
+            else
+                partial.emplace(std::move(result.Value()));
+        }
+        partials[chunk] = std::move(partial);
+    });
+
+    using Output = Result<T, ErrorType>;
+    if (first_error.Get() != FirstErrorIndex::kNone)
+        return Output(std::move(*chunk_errors[first_error.Get() / grain]));
+    for (auto& partial : partials) {
+        if (partial) init = reduce(std::move(init), std::move(*partial));
+    }
+    return Output(std::move(init));
+}
+
+#endif // ERROR_HANDLING_PARALLEL_ALGORITHM_H_
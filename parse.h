@@ -0,0 +1,107 @@
+#ifndef ERROR_HANDLING_PARSE_H_
+#define ERROR_HANDLING_PARSE_H_
+
+// 基于 std::from_chars 的字符串解析，不依赖 locale，不读写 errno，
+// 也不要求以 '\0' 结尾，可以直接解析 std::string_view：
+//
+//   Result<int, ParseError> n = ParseInt("123");
+//   Result<double, ParseError> x = ParseDouble(line.substr(10, 8));
+//   if (!n.OK()) std::cout << "bad char at " << n.Error().Offset() << '\n';
+//
+// 整个字符串都必须是合法的内容，不允许前后的空白。整数可以带正负号（无符号数只能带 '+'），
+// 进制由参数指定，不识别 0x 之类的前缀。出错时 ParseError 里带有出错的位置：
+// 非法字符指向第一个不能解析的字符，超出范围指向数字的开头。
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include "result.h"
+
+enum class ParseErrorCode {
+    kInvalid = 1,  // 空字符串、非法字符或多余的字符
+    kOutOfRange,   // 超出了目标类型的范围
+};
+
+// 解析错误，带有出错的字符在输入中的位置
+class ParseError : public TypedError<ParseErrorCode> {
+public:
+    ParseError() {}
+    ParseError(ParseErrorCode code, std::size_t offset,
+               const char* file = __builtin_FILE(), int line = __builtin_LINE(),
+               const char* function = __builtin_FUNCTION())
+        : TypedError<ParseErrorCode>(code, file, line, function), offset_(offset) {
+    }
+
+    std::size_t Offset() const {
+        return offset_;
+    }
+
+private:
+    std::size_t offset_ = 0;
+};
+
+namespace parse_internal {
+
+// 根据 from_chars 的返回值生成结果，start 是数字在 s 中的起始位置
+template <typename T>
+Result<T, ParseError> Finish(std::string_view s, std::size_t start, std::from_chars_result r, T value) {
+    if (r.ec == std::errc::result_out_of_range) return ParseError(ParseErrorCode::kOutOfRange, start);
+    if (r.ec != std::errc()) return ParseError(ParseErrorCode::kInvalid, start);
+    if (r.ptr != s.data() + s.size()) return ParseError(ParseErrorCode::kInvalid, r.ptr - s.data());
+    return value;
+}
+
+} // namespace parse_internal
+
+// 解析任意整数类型
+template <typename T>
+Result<T, ParseError> ParseInteger(std::string_view s, int base = 10) {
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "use ParseBool for bool");
+    // from_chars 接受 '-' 但不接受 '+'，这里自己跳过 '+'，并拒绝 "+-1" 这样的写法
+    std::size_t start = 0;
+    if (!s.empty() && s[0] == '+') {
+        start = 1;
+        if (s.size() > 1 && s[1] == '-') return ParseError(ParseErrorCode::kInvalid, 1);
+    }
+    T value{};
+    auto r = std::from_chars(s.data() + start, s.data() + s.size(), value, base);
+    // 无符号类型遇到 '-' 时 from_chars 报告非法，位置就是 '-' 本身
+    return parse_internal::Finish(s, start, r, value);
+}
+
+inline Result<int, ParseError> ParseInt(std::string_view s, int base = 10) {
+    return ParseInteger<int>(s, base);
+}
+
+inline Result<int64_t, ParseError> ParseInt64(std::string_view s, int base = 10) {
+    return ParseInteger<int64_t>(s, base);
+}
+
+inline Result<unsigned, ParseError> ParseUInt(std::string_view s, int base = 10) {
+    return ParseInteger<unsigned>(s, base);
+}
+
+// 接受定点和科学计数法，以及 inf 和 nan
+inline Result<double, ParseError> ParseDouble(std::string_view s) {
+    std::size_t start = 0;
+    if (!s.empty() && s[0] == '+') {
+        start = 1;
+        if (s.size() > 1 && s[1] == '-') return ParseError(ParseErrorCode::kInvalid, 1);
+    }
+    double value = 0;
+    auto r = std::from_chars(s.data() + start, s.data() + s.size(), value);
+    return parse_internal::Finish(s, start, r, value);
+}
+
+// 只接受 "true"、"false"、"1" 和 "0"
+inline Result<bool, ParseError> ParseBool(std::string_view s) {
+    if (s == "true" || s == "1") return true;
+    if (s == "false" || s == "0") return false;
+    return ParseError(ParseErrorCode::kInvalid, 0);
+}
+
+#endif // ERROR_HANDLING_PARSE_H_
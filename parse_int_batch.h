@@ -0,0 +1,288 @@
+#ifndef ERROR_HANDLING_PARSE_INT_BATCH_H_
+#define ERROR_HANDLING_PARSE_INT_BATCH_H_
+
+// 批量解析整数，语义和 result.cpp 里基于 strtol 的 ParseInt 完全相同：
+//
+//   std::vector<std::string_view> column = ...;
+//   ResultBatch<int> ints = ParseIntBatch(column);
+//   ints.ForEachError([](std::size_t i, const GenericError& e) { ... });  // e.Code() 为 EINVAL/ERANGE
+//
+// 绝大多数输入是不带前导 0 的十进制数（可以带正负号），这部分用 SIMD 把最多
+// 16 个数字一次转换成整数：SSE4.2 每次处理一个字符串，AVX2 每次处理两个。
+// 空白、十六进制、八进制（前导 0）、非法字符等其他情况回退到 strtol，
+// 因此得到的值和错误码与 ParseInt 一致。运行时根据 CPU 选择实现，非 x86 平台上
+// 只有标量的实现。
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ERROR_HANDLING_PARSE_INT_X86 1
+#include <immintrin.h>
+#endif
+
+#include "result.h"
+#include "result_batch.h"
+
+enum class ParseIntIsa { kScalar, kSse42, kAvx2 };
+
+inline ParseIntIsa BestParseIntIsa() {
+#if defined(ERROR_HANDLING_PARSE_INT_X86)
+    static const ParseIntIsa isa = __builtin_cpu_supports("avx2")     ? ParseIntIsa::kAvx2
+                                   : __builtin_cpu_supports("sse4.2") ? ParseIntIsa::kSse42
+                                                                      : ParseIntIsa::kScalar;
+    return isa;
+#else
+    return ParseIntIsa::kScalar;
+#endif
+}
+
+namespace parse_int_internal {
+
+// 和 ParseInt 一样调用 strtol，返回错误码，0 表示成功
+inline int ParseWithStrtol(std::string_view s, int* value) {
+    char small[32];
+    std::string large;
+    const char* str = small;
+    if (s.size() < sizeof(small)) {
+        std::memcpy(small, s.data(), s.size());
+        small[s.size()] = '\0';
+    } else {
+        large.assign(s);
+        str = large.c_str();
+    }
+    errno = 0;
+    char* end = const_cast<char*>(str);
+    long n = strtol(str, &end, 0);
+    if (errno != 0) return errno;
+    if (*end != '\0') return EINVAL;
+    if (n > INT_MAX || n < INT_MIN) return ERANGE;
+    *value = static_cast<int>(n);
+    return 0;
+}
+
+// 快速路径能处理的形式：可选的正负号，后面是 1 到 10 个字符（int 最多 10 位），
+// 不以 0 开头（以 0 开头在 strtol 里是八进制），单独的 "0" 除外。
+// 这里只检查长度和开头，是否全是数字由后面的转换检查。
+struct Candidate {
+    const char* digits;
+    std::size_t length;
+    bool negative;
+};
+
+inline bool MakeCandidate(std::string_view s, Candidate* candidate) {
+    std::size_t i = 0;
+    bool negative = false;
+    if (!s.empty() && (s[0] == '-' || s[0] == '+')) {
+        negative = s[0] == '-';
+        i = 1;
+    }
+    std::size_t length = s.size() - i;
+    if (length == 0 || length > 10) return false;
+    if (s[i] == '0' && length != 1) return false;
+    *candidate = Candidate{s.data() + i, length, negative};
+    return true;
+}
+
+// 检查范围并写出结果，返回错误码
+inline int Finish(uint64_t magnitude, bool negative, int* value) {
+    if (negative) {
+        if (magnitude > uint64_t(INT_MAX) + 1) return ERANGE;
+        *value = static_cast<int>(-static_cast<int64_t>(magnitude));
+    } else {
+        if (magnitude > uint64_t(INT_MAX)) return ERANGE;
+        *value = static_cast<int>(magnitude);
+    }
+    return 0;
+}
+
+inline bool DigitsScalar(const char* p, std::size_t n, uint64_t* out) {
+    uint64_t v = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        unsigned d = static_cast<unsigned char>(p[i]) - '0';
+        if (d > 9) return false;
+        v = v * 10 + d;
+    }
+    *out = v;
+    return true;
+}
+
+// 解析一个字符串，先走标量的快速路径，不行再用 strtol
+inline int ParseOneScalar(std::string_view s, int* value) {
+    Candidate c;
+    uint64_t magnitude;
+    if (MakeCandidate(s, &c) && DigitsScalar(c.digits, c.length, &magnitude))
+        return Finish(magnitude, c.negative, value);
+    return ParseWithStrtol(s, value);
+}
+
+#if defined(ERROR_HANDLING_PARSE_INT_X86)
+
+// 第 n 项把前 n 个字节移到 16 字节的末尾，其余位置清零，这样各个数字的位权固定
+struct RightAlignTable {
+    alignas(16) int8_t masks[17][16];
+    constexpr RightAlignTable() : masks() {
+        for (int n = 0; n <= 16; ++n) {
+            for (int j = 0; j < 16; ++j)
+                masks[n][j] = j >= 16 - n ? static_cast<int8_t>(j - (16 - n)) : int8_t(-128);
+        }
+    }
+};
+inline constexpr RightAlignTable kRightAlign;
+
+// 读取从 p 开始的 16 个字节，只有前 n 个有意义。不跨页时直接多读，
+// 这不会引起访问错误，但 ASan 会报告越界
+__attribute__((target("sse4.2"))) inline __m128i Load16(const char* p, std::size_t n) {
+    if ((reinterpret_cast<uintptr_t>(p) & 4095) <= 4096 - 16)
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    char buffer[16] = {};
+    std::memcpy(buffer, p, n);
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer));
+}
+
+__attribute__((target("sse4.2"))) inline bool DigitsSse42(const char* p, std::size_t n, uint64_t* out) {
+    const __m128i chars = Load16(p, n);
+    // 在前 n 个字节中找第一个不在 '0'..'9' 范围内的，找不到时返回 16
+    const __m128i range = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const int bad = _mm_cmpestri(range, 2, chars, static_cast<int>(n),
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_MASKED_NEGATIVE_POLARITY);
+    if (bad < static_cast<int>(n)) return false;
+    __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    digits = _mm_shuffle_epi8(digits,
+                              _mm_load_si128(reinterpret_cast<const __m128i*>(kRightAlign.masks[n])));
+    // 相邻的数字两两合并，依次得到 2 位、4 位、8 位的部分值
+    const __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+                                                                  10, 1, 10, 1, 10, 1, 10, 1));
+    const __m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    const __m128i packed = _mm_packus_epi32(quads, quads);
+    const __m128i octets = _mm_madd_epi16(packed, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    const uint64_t high = static_cast<uint32_t>(_mm_cvtsi128_si32(octets));
+    const uint64_t low = static_cast<uint32_t>(_mm_extract_epi32(octets, 1));
+    *out = high * 100000000 + low;
+    return true;
+}
+
+// 同时转换两个候选，每个 128 位的半边处理一个。返回值的第 0、1 位表示对应的候选
+// 是否全是数字
+__attribute__((target("avx2"))) inline unsigned DigitsAvx2(const Candidate& a, const Candidate& b,
+                                                          uint64_t* out_a, uint64_t* out_b) {
+    const __m256i chars = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(Load16(a.digits, a.length)), Load16(b.digits, b.length), 1);
+    __m256i digits = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+    // 数字减去 '0' 后在 0..9 之间，用无符号的 min 判断
+    const __m256i nines = _mm256_set1_epi8(9);
+    const uint32_t is_digit =
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(digits, nines), digits)));
+    const uint32_t need_a = (1u << a.length) - 1;
+    const uint32_t need_b = ((1u << b.length) - 1) << 16;
+    unsigned ok = ((is_digit & need_a) == need_a ? 1u : 0u) | ((is_digit & need_b) == need_b ? 2u : 0u);
+
+    const __m256i align = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kRightAlign.masks[a.length]))),
+        _mm_load_si128(reinterpret_cast<const __m128i*>(kRightAlign.masks[b.length])), 1);
+    digits = _mm256_shuffle_epi8(digits, align);
+    const __m256i pairs = _mm256_maddubs_epi16(digits, _mm256_set1_epi16(0x010A));  // 字节依次为 10, 1
+    const __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00010064));  // 100, 1
+    const __m256i packed = _mm256_packus_epi32(quads, quads);
+    const __m256i octets = _mm256_madd_epi16(packed, _mm256_set1_epi32(0x00012710));  // 10000, 1
+    *out_a = static_cast<uint32_t>(_mm256_extract_epi32(octets, 0)) * uint64_t(100000000) +
+             static_cast<uint32_t>(_mm256_extract_epi32(octets, 1));
+    *out_b = static_cast<uint32_t>(_mm256_extract_epi32(octets, 4)) * uint64_t(100000000) +
+             static_cast<uint32_t>(_mm256_extract_epi32(octets, 5));
+    return ok;
+}
+
+__attribute__((target("sse4.2"))) inline int ParseOneSse42(std::string_view s, int* value) {
+    Candidate c;
+    uint64_t magnitude;
+    if (MakeCandidate(s, &c) && DigitsSse42(c.digits, c.length, &magnitude))
+        return Finish(magnitude, c.negative, value);
+    return ParseWithStrtol(s, value);
+}
+
+__attribute__((target("sse4.2"))) inline std::size_t ParseLanesSse42(
+    std::span<const std::string_view> inputs, int* values, int* errors) {
+    std::size_t failed = 0;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        values[i] = 0;
+        errors[i] = ParseOneSse42(inputs[i], &values[i]);
+        failed += errors[i] != 0;
+    }
+    return failed;
+}
+
+__attribute__((target("avx2"))) inline std::size_t ParseLanesAvx2(
+    std::span<const std::string_view> inputs, int* values, int* errors) {
+    std::size_t failed = 0;
+    std::size_t i = 0;
+    for (; i + 2 <= inputs.size(); i += 2) {
+        values[i] = values[i + 1] = 0;
+        Candidate a, b;
+        if (MakeCandidate(inputs[i], &a) && MakeCandidate(inputs[i + 1], &b)) {
+            uint64_t ma, mb;
+            unsigned ok = DigitsAvx2(a, b, &ma, &mb);
+            errors[i] = ok & 1 ? Finish(ma, a.negative, &values[i]) : ParseWithStrtol(inputs[i], &values[i]);
+            errors[i + 1] = ok & 2 ? Finish(mb, b.negative, &values[i + 1])
+                                   : ParseWithStrtol(inputs[i + 1], &values[i + 1]);
+        } else {
+            errors[i] = ParseOneSse42(inputs[i], &values[i]);
+            errors[i + 1] = ParseOneSse42(inputs[i + 1], &values[i + 1]);
+        }
+        failed += (errors[i] != 0) + (errors[i + 1] != 0);
+    }
+    if (i < inputs.size()) {
+        values[i] = 0;
+        errors[i] = ParseOneSse42(inputs[i], &values[i]);
+        failed += errors[i] != 0;
+    }
+    return failed;
+}
+
+#endif // ERROR_HANDLING_PARSE_INT_X86
+
+inline std::size_t ParseLanesScalar(std::span<const std::string_view> inputs, int* values, int* errors) {
+    std::size_t failed = 0;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        values[i] = 0;
+        errors[i] = ParseOneScalar(inputs[i], &values[i]);
+        failed += errors[i] != 0;
+    }
+    return failed;
+}
+
+} // namespace parse_int_internal
+
+// 解析 inputs 中的每个字符串，values[i] 为解析出的值，errors[i] 为 0、EINVAL 或 ERANGE，
+// 出错时 values[i] 为 0。返回出错的个数。isa 用于指定实现，便于对比测试，
+// 指定的指令集必须是 CPU 支持的。
+inline std::size_t ParseIntLanes(std::span<const std::string_view> inputs, int* values, int* errors,
+                                 ParseIntIsa isa = BestParseIntIsa()) {
+#if defined(ERROR_HANDLING_PARSE_INT_X86)
+    if (isa == ParseIntIsa::kAvx2) return parse_int_internal::ParseLanesAvx2(inputs, values, errors);
+    if (isa == ParseIntIsa::kSse42) return parse_int_internal::ParseLanesSse42(inputs, values, errors);
+#endif
+    return parse_int_internal::ParseLanesScalar(inputs, values, errors);
+}
+
+// 解析结果放在 ResultBatch 里，错误为以 EINVAL 或 ERANGE 为错误码的 GenericError
+inline ResultBatch<int> ParseIntBatch(std::span<const std::string_view> inputs,
+                                      ParseIntIsa isa = BestParseIntIsa()) {
+    ResultBatch<int> batch(inputs.size());
+    std::vector<int> errors(inputs.size());
+    if (ParseIntLanes(inputs, batch.Values(), errors.data(), isa) != 0) {
+        for (std::size_t i = 0; i < errors.size(); ++i) {
+            if (errors[i] != 0) batch.SetError(i, GenericError(errors[i]));
+        }
+    }
+    return batch;
+}
+
+#endif // ERROR_HANDLING_PARSE_INT_BATCH_H_
@@ -0,0 +1,142 @@
+#ifndef ERROR_HANDLING_PARSE_LINES_H_
+#define ERROR_HANDLING_PARSE_LINES_H_
+
+// 并行解析每行一个整数的大文本（比如 mmap 进来的几个 GB 的文件）：
+//
+//   Result<std::vector<int64_t>, TextParseError> column = ParseIntegerLines<int64_t>(pool, text);
+//   if (!column.OK())
+//       std::cerr << "line " << column.Error().LineNumber() << ", column " << column.Error().Column();
+//
+// 文本按大致相同的大小在换行处切成若干块，各块用 parse.h 里的 ParseInteger 并行解析，
+// 最后按顺序拼接。出错时返回整个文本中第一个错误，带有字节偏移和行列号；和
+// parallel_algorithm.h 一样，位于出错块之后的块会被跳过，之前的块都会处理完，
+// 所以报告的错误和线程调度无关。
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "parallel_algorithm.h"
+#include "parse.h"
+#include "result.h"
+#include "thread_pool.h"
+
+// 文本解析错误，在 ParseError 的基础上带有在整个文本中的位置
+class TextParseError : public ParseError {
+public:
+    TextParseError() {}
+    TextParseError(const ParseError& error, std::size_t byte_offset, std::size_t line_number,
+                   std::size_t column)
+        : ParseError(error), byte_offset_(byte_offset), line_number_(line_number), column_(column) {
+    }
+
+    // 出错的字符在整个文本中的字节偏移，从 0 开始
+    std::size_t ByteOffset() const {
+        return byte_offset_;
+    }
+    // 行号和列号，都从 1 开始
+    std::size_t LineNumber() const {
+        return line_number_;
+    }
+    std::size_t Column() const {
+        return column_;
+    }
+
+private:
+    std::size_t byte_offset_ = 0;
+    std::size_t line_number_ = 0;
+    std::size_t column_ = 0;
+};
+
+namespace parse_lines_internal {
+
+// 把 text 在换行处切成大约 chunk_size 大小的块，返回各块的起始位置，最后一项是 text.size()
+inline std::vector<std::size_t> SplitAtNewlines(std::string_view text, std::size_t chunk_size) {
+    std::vector<std::size_t> bounds{0};
+    std::size_t pos = 0;
+    while (text.size() - pos > chunk_size) {
+        const void* nl = std::memchr(text.data() + pos + chunk_size, '\n', text.size() - pos - chunk_size);
+        if (!nl) break;
+        pos = static_cast<const char*>(nl) - text.data() + 1;
+        if (pos == text.size()) break;
+        bounds.push_back(pos);
+    }
+    bounds.push_back(text.size());
+    return bounds;
+}
+
+template <typename T>
+struct ChunkOutput {
+    std::vector<T> values;  // 每行一个值，所以也是本块成功解析的行数
+    std::optional<ParseError> error;
+    std::size_t error_offset = 0;  // 出错的字符相对于块开头的偏移
+    std::size_t error_column = 0;
+};
+
+template <typename T>
+void ParseChunk(std::string_view chunk, int base, ChunkOutput<T>* output) {
+    std::size_t pos = 0;
+    while (pos < chunk.size()) {
+        std::size_t end = chunk.find('\n', pos);
+        if (end == std::string_view::npos) end = chunk.size();
+        std::string_view line = chunk.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        auto result = ParseInteger<T>(line, base);
+        if (!result.OK()) {
+            output->error_offset = pos + result.Error().Offset();
+            output->error_column = result.Error().Offset() + 1;
+            output->error.emplace(result.Error());
+            return;
+        }
+        output->values.push_back(result.Value());
+        pos = end + 1;
+    }
+}
+
+} // namespace parse_lines_internal
+
+// 解析 text 中的每一行为一个 T 类型的整数。行尾可以是 "\n" 或 "\r\n"，文本末尾的
+// 换行可有可无，中间的空行算作错误。chunk_size 为 0 时根据文本大小和线程数自动选择。
+template <typename T>
+Result<std::vector<T>, TextParseError> ParseIntegerLines(ThreadPool& pool, std::string_view text,
+                                                         int base = 10, std::size_t chunk_size = 0) {
+    using Output = Result<std::vector<T>, TextParseError>;
+    if (chunk_size == 0)
+        chunk_size = std::max<std::size_t>(1 << 20, text.size() / (8 * (pool.Size() + 1)));
+
+    const std::vector<std::size_t> bounds = parse_lines_internal::SplitAtNewlines(text, chunk_size);
+    const std::size_t num_chunks = bounds.size() - 1;
+    std::vector<parse_lines_internal::ChunkOutput<T>> outputs(num_chunks);
+    FirstErrorIndex first_error;
+
+    ParallelChunks::Run(pool, num_chunks, [&](std::size_t chunk) {
+        if (chunk > first_error.Get()) return;
+        std::string_view part = text.substr(bounds[chunk], bounds[chunk + 1] - bounds[chunk]);
+        parse_lines_internal::ParseChunk(part, base, &outputs[chunk]);
+        if (outputs[chunk].error) first_error.Update(chunk);
+    });
+
+    if (first_error.Get() != FirstErrorIndex::kNone) {
+        const std::size_t chunk = first_error.Get();
+        // 出错块之前的块都完整解析了，它们的值的个数就是行数
+        std::size_t line = 1;
+        for (std::size_t i = 0; i <= chunk; ++i) line += outputs[i].values.size();
+        auto& output = outputs[chunk];
+        return Output(TextParseError(*output.error, bounds[chunk] + output.error_offset, line,
+                                     output.error_column));
+    }
+
+    std::vector<std::size_t> starts(num_chunks + 1, 0);
+    for (std::size_t i = 0; i < num_chunks; ++i) starts[i + 1] = starts[i] + outputs[i].values.size();
+    std::vector<T> values(starts.back());
+    ParallelChunks::Run(pool, num_chunks, [&](std::size_t chunk) {
+        std::copy(outputs[chunk].values.begin(), outputs[chunk].values.end(), values.begin() + starts[chunk]);
+        outputs[chunk].values = std::vector<T>();
+    });
+    return Output(std::move(values));
+}
+
+#endif // ERROR_HANDLING_PARSE_LINES_H_
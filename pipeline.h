@@ -0,0 +1,292 @@
+#ifndef ERROR_HANDLING_PIPELINE_H_
+#define ERROR_HANDLING_PIPELINE_H_
+
+// 多线程流水线，把 GetIntFromFile 里 OpenFile -> Read -> ParseInt 这样的串行步骤
+// 推广到一串输入上，每一级在自己的线程里并行执行：
+//
+//   auto pipeline = Pipeline<std::string>()
+//       .Then("open", OpenFile, {.parallelism = 2})
+//       .Then("read", [](File f) { return f.Read(); })
+//       .Then("parse", [](std::string s) { return ParseInt(s); }, {.parallelism = 4});
+//   std::vector<Result<int>> results = pipeline.Run(filenames);
+//
+// 每一级是一个返回 Result 的函数。某个元素在某一级出错后不再进入后面的级，
+// 错误直接交给结果，其他元素照常流动。级与级之间用 MpmcQueue 连接，按批传递；
+// 队列满时上游退避等待，形成反压。每一级都统计处理的元素数和出错数。
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mpmc_queue.h"
+#include "result.h"
+#include "spin_wait.h"
+
+struct PipelineStageOptions {
+    int parallelism = 1;          // 本级的线程数，小于 1 时按 1 处理
+    std::size_t batch_size = 16;  // 每次从上游取、往下游放的最大元素个数，为 0 时按 1 处理
+};
+
+struct PipelineStageStats {
+    explicit PipelineStageStats(std::string name) : name(std::move(name)) {}
+    std::string name;
+    std::atomic<uint64_t> processed{0};
+    std::atomic<uint64_t> errors{0};
+};
+
+// 在级之间传递的元素，带着它在输入中的序号
+template <typename T>
+struct PipelineItem {
+    std::size_t index;
+    T value;
+};
+
+template <typename T, typename ErrorType>
+using PipelineQueue = MpmcQueue<PipelineItem<T>, ErrorType>;
+
+// 把 items 全部放进队列，队列满时退避等待
+template <typename T, typename ErrorType>
+void PipelinePushAll(PipelineQueue<T, ErrorType>& queue,
+                     std::vector<Result<PipelineItem<T>, ErrorType>>& items) {
+    std::size_t done = 0;
+    Backoff backoff;
+    while (done < items.size()) {
+        auto pushed = queue.TryPushBatch(items.data() + done, items.size() - done);
+        if (pushed.OK()) {
+            done += pushed.Value();
+            backoff.Reset();
+        } else {
+            backoff.Pause();
+        }
+    }
+    items.clear();
+}
+
+template <typename ErrorType>
+class PipelineStageBase {
+public:
+    explicit PipelineStageBase(std::string name) : stats_(std::move(name)) {}
+    virtual ~PipelineStageBase() = default;
+    virtual void Start(const std::function<void(std::size_t, const ErrorType&)>* on_error) = 0;
+    virtual void Join() = 0;
+
+    const PipelineStageStats& Stats() const {
+        return stats_;
+    }
+
+protected:
+    PipelineStageStats stats_;
+};
+
+template <typename In, typename Out, typename ErrorType, typename Function>
+class PipelineStage : public PipelineStageBase<ErrorType> {
+public:
+    PipelineStage(std::string name, Function function, PipelineStageOptions options,
+                  std::size_t queue_capacity, PipelineQueue<In, ErrorType>* input,
+                  const std::atomic<bool>* input_done)
+        : PipelineStageBase<ErrorType>(std::move(name)),
+          function_(std::move(function)),
+          options_(Normalize(options)),
+          input_(input),
+          input_done_(input_done),
+          output_(queue_capacity) {}
+
+    PipelineQueue<Out, ErrorType>* Output() {
+        return &output_;
+    }
+    const std::atomic<bool>* OutputDone() const {
+        return &output_done_;
+    }
+
+    void Start(const std::function<void(std::size_t, const ErrorType&)>* on_error) override {
+        on_error_ = on_error;
+        output_done_.store(false, std::memory_order_relaxed);
+        live_workers_.store(options_.parallelism, std::memory_order_relaxed);
+        for (int i = 0; i < options_.parallelism; ++i)
+            threads_.emplace_back([this] { Run(); });
+    }
+
+    void Join() override {
+        for (auto& thread : threads_) thread.join();
+        threads_.clear();
+    }
+
+private:
+    // 线程数或批大小不是正数时没有线程取元素，Run 会一直等下去，按 1 处理
+    static PipelineStageOptions Normalize(PipelineStageOptions options) {
+        if (options.parallelism < 1) options.parallelism = 1;
+        if (options.batch_size == 0) options.batch_size = 1;
+        return options;
+    }
+
+    void Run() {
+        std::vector<PipelineItem<In>> batch;
+        std::vector<Result<PipelineItem<Out>, ErrorType>> outputs;
+        Backoff backoff;
+        for (;;) {
+            // 先看上游是否已经结束，再取元素，这样取不到时就可以确定没有更多元素了
+            const bool upstream_done = input_done_->load(std::memory_order_acquire);
+            std::size_t n = input_->TryPopBatch(
+                options_.batch_size,
+                [&](Result<PipelineItem<In>, ErrorType>&& item) {
+                    batch.push_back(std::move(item.Value()));
+                });
+            if (n == 0) {
+                if (upstream_done) break;
+                backoff.Pause();
+                continue;
+            }
+            backoff.Reset();
+            for (auto& item : batch) {
+                auto result = function_(std::move(item.value));
+                this->stats_.processed.fetch_add(1, std::memory_order_relaxed);
+                if (result.OK()) {
+                    outputs.push_back(PipelineItem<Out>{item.index, std::move(result.Value())});
+                } else {
+                    this->stats_.errors.fetch_add(1, std::memory_order_relaxed);
+                    (*on_error_)(item.index, ErrorType(result.Error()));
+                }
+            }
+            batch.clear();
+            PipelinePushAll(output_, outputs);
+        }
+        if (live_workers_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            output_done_.store(true, std::memory_order_release);
+    }
+
+    Function function_;
+    PipelineStageOptions options_;
+    PipelineQueue<In, ErrorType>* input_;
+    const std::atomic<bool>* input_done_;
+    PipelineQueue<Out, ErrorType> output_;
+    std::atomic<bool> output_done_{false};
+    std::atomic<int> live_workers_{0};
+    const std::function<void(std::size_t, const ErrorType&)>* on_error_ = nullptr;
+    std::vector<std::thread> threads_;
+};
+
+// 流水线的输入队列和各级，和最后一级的输出类型无关
+template <typename In, typename ErrorType>
+struct PipelineState {
+    explicit PipelineState(std::size_t capacity) : queue_capacity(capacity), input(capacity) {}
+    std::size_t queue_capacity;
+    PipelineQueue<In, ErrorType> input;
+    std::atomic<bool> input_done{false};
+    std::vector<std::unique_ptr<PipelineStageBase<ErrorType>>> stages;
+};
+
+// In 是整条流水线的输入类型，Out 是目前最后一级的输出类型
+template <typename In, typename Out = In, typename ErrorType = GenericError>
+class Pipeline {
+public:
+    explicit Pipeline(std::size_t queue_capacity = 1024)
+        : state_(std::make_unique<State>(queue_capacity)),
+          tail_(&state_->input),
+          tail_done_(&state_->input_done) {
+        static_assert(std::is_same_v<In, Out>, "use Then() to add stages");
+    }
+
+    // 追加一级。function 以 Out 为参数，返回某种 Result<NewOut, E2>，E2 要能转换为 ErrorType
+    template <typename Function>
+    auto Then(std::string name, Function function, PipelineStageOptions options = {}) && {
+        using StageResult = std::invoke_result_t<Function&, Out&&>;
+        using NewOut = typename ResultTraits<StageResult>::ValueType;
+        using Stage = PipelineStage<Out, NewOut, ErrorType, Function>;
+        auto stage = std::make_unique<Stage>(std::move(name), std::move(function), options,
+                                             state_->queue_capacity, tail_, tail_done_);
+        Pipeline<In, NewOut, ErrorType> next(std::move(state_), stage->Output(), stage->OutputDone());
+        next.state_->stages.push_back(std::move(stage));
+        return next;
+    }
+
+    // 运行流水线直到 source 返回 std::nullopt 并且所有元素都处理完。
+    // sink 以 (输入序号, Result<Out, ErrorType>&&) 调用，可能在多个线程里并发调用。
+    template <typename Source, typename Sink>
+    void Run(Source source, Sink sink) {
+        std::function<void(std::size_t, const ErrorType&)> on_error =
+            [&](std::size_t index, const ErrorType& error) {
+                sink(index, Result<Out, ErrorType>(error));
+            };
+        state_->input_done.store(false, std::memory_order_relaxed);
+        for (auto& stage : state_->stages) stage->Start(&on_error);
+
+        std::thread feeder([&] {
+            std::vector<Result<PipelineItem<In>, ErrorType>> batch;
+            std::size_t index = 0;
+            while (std::optional<In> input = source()) {
+                batch.push_back(PipelineItem<In>{index++, std::move(*input)});
+                if (batch.size() == kFeedBatch) PipelinePushAll(state_->input, batch);
+            }
+            PipelinePushAll(state_->input, batch);
+            state_->input_done.store(true, std::memory_order_release);
+        });
+
+        Backoff backoff;
+        for (;;) {
+            const bool done = tail_done_->load(std::memory_order_acquire);
+            std::size_t n = tail_->TryPopBatch(
+                kFeedBatch, [&](Result<PipelineItem<Out>, ErrorType>&& item) {
+                    sink(item.Value().index, Result<Out, ErrorType>(std::move(item.Value().value)));
+                });
+            if (n != 0) {
+                backoff.Reset();
+            } else if (done) {
+                break;
+            } else {
+                backoff.Pause();
+            }
+        }
+        feeder.join();
+        for (auto& stage : state_->stages) stage->Join();
+    }
+
+    // 处理一组输入，结果按输入的顺序排列
+    std::vector<Result<Out, ErrorType>> Run(std::vector<In> inputs) {
+        std::vector<std::optional<Result<Out, ErrorType>>> slots(inputs.size());
+        std::size_t next = 0;
+        Run([&]() -> std::optional<In> {
+                if (next == inputs.size()) return std::nullopt;
+                return std::move(inputs[next++]);
+            },
+            [&](std::size_t index, Result<Out, ErrorType>&& result) {
+                slots[index].emplace(std::move(result));
+            });
+        std::vector<Result<Out, ErrorType>> results;
+        results.reserve(slots.size());
+        for (auto& slot : slots) results.push_back(std::move(*slot));
+        return results;
+    }
+
+    // 各级的统计，按级的顺序排列
+    std::vector<const PipelineStageStats*> Stats() const {
+        std::vector<const PipelineStageStats*> stats;
+        for (auto& stage : state_->stages) stats.push_back(&stage->Stats());
+        return stats;
+    }
+
+private:
+    template <typename In2, typename Out2, typename ErrorType2>
+    friend class Pipeline;
+
+    using State = PipelineState<In, ErrorType>;
+
+    static constexpr std::size_t kFeedBatch = 64;
+
+    Pipeline(std::unique_ptr<State> state, PipelineQueue<Out, ErrorType>* tail,
+             const std::atomic<bool>* tail_done)
+        : state_(std::move(state)), tail_(tail), tail_done_(tail_done) {}
+
+    std::unique_ptr<State> state_;
+    PipelineQueue<Out, ErrorType>* tail_;
+    const std::atomic<bool>* tail_done_;
+};
+
+#endif // ERROR_HANDLING_PIPELINE_H_
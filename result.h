@@ -0,0 +1,325 @@
+#ifndef ERROR_HANDLING_RESULT_H_
+#define ERROR_HANDLING_RESULT_H_
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 尝试山寨一下 rust 里的 std::Result 错误处理机制
+// 一个 Result 对象要么含有有个有效的 Value，要么只包含一个 Error
+
+template <typename Type>
+struct ErrorCodeTraits {
+    static const char* Name();
+    static const char* ToString(Type vale);
+};
+
+class ErrorMeta {
+public:
+    virtual const char* Name() const;
+    virtual const char* ToString(int vale) const;
+};
+
+namespace result_internal {
+
+inline int NextErrorDomain() {
+    static std::atomic<int> next{0};
+    return next.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+} // namespace result_internal
+
+// 错误域的编号，每种错误码类型一个，从 1 开始，0 表示没有错误
+template <typename ErrorCode>
+int ErrorDomain() {
+    static const int domain = result_internal::NextErrorDomain();
+    return domain;
+}
+
+struct SourceLocation {
+    const char* file;
+    int line;
+    const char* function;
+};
+
+
+class ErrorImpl {
+public:
+    ErrorImpl(int domain, int code, const char* file, int line, const char* function)
+        : domain_(domain), code_(code), file_(file), line_(line), function_(function) {
+    }
+    virtual ~ErrorImpl() = default;
+    const char* File() const { return file_; }
+    int Line() const { return line_; }
+    const char* Function() const { return function_; }
+    int Domain() const { return domain_; }
+    int Code() const { return code_; }
+    virtual const ErrorImpl* Cause() const { return nullptr; }
+private:
+    int domain_;
+    int code_;
+    const char* file_;
+    int line_;
+    const char* function_;
+};
+
+// 放一些共用的成员函数
+class BaseError {
+protected:
+    BaseError() {}
+    BaseError(int domain, int code, const char* file, int line, const char* function)
+        : error_{std::make_shared<ErrorImpl>(domain, code, file, line, function)} {
+    }
+
+    int RawCode() const {
+        if (!error_) return 0;
+        return error_->Code();
+    }
+
+public:
+    explicit operator bool() const {
+        return error_ && int(error_->Code()) != 0;
+    }
+    bool operator!() const {
+        return !static_cast<bool>(*this);
+    }
+
+    std::string Message() const {
+        // TODO: uses ErrorCodeTraits
+        return "";
+    }
+
+    // 构造时的错误码类型，GenericError 从 TypedError 转换过来时保留原来的错误域
+    int Domain() const {
+        if (!error_) return 0;
+        return error_->Domain();
+    }
+
+    const char* File() const { return error_->File(); }
+    int Line() const { return error_->Line(); }
+    const char* Function() const { return error_->Function(); }
+
+    std::vector<ErrorImpl*> Stack() const;
+
+private:
+    std::shared_ptr<ErrorImpl> error_;
+};
+
+// 对特定枚举错误码类型的包装，支持作为 bool 来检测以及转字符串，发生位置等便利操作。
+// 此处用了 GCC 扩展的 __builtin_FILE等，c++2a 的 source_lication 可能更合适。
+template <typename ErrorCode>
+class TypedError : public BaseError {
+public:
+    TypedError() {}
+    TypedError(ErrorCode code,
+               const char* file = __builtin_FILE(), int line = __builtin_LINE(),
+               const char* function = __builtin_FUNCTION())
+        : BaseError(ErrorDomain<ErrorCode>(), (int)code, file, line, function) {
+    }
+
+    template <typename CauseError>
+    TypedError(ErrorCode code, CauseError cause,
+               const char* file = __builtin_FILE(), int line = __builtin_LINE(),
+               const char* function = __builtin_FUNCTION());
+
+    ErrorCode Code() const {
+        return static_cast<ErrorCode>(RawCode());
+    }
+};
+
+// 能兼容一切错误的错误
+class GenericError : public BaseError {
+public:
+    GenericError() {}
+
+    GenericError(int code,
+                 const char* file = __builtin_FILE(), int line = __builtin_LINE(),
+                 const char* function = __builtin_FUNCTION())
+        : BaseError(ErrorDomain<int>(), code, file, line, function) {
+    }
+
+    template <typename CauseError>
+    GenericError(int code, CauseError cause, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+    template <typename ErrorType>
+    GenericError(ErrorType error) : BaseError(error) {
+    }
+
+    int Code() const {
+        return RawCode();
+    }
+};
+
+// Result 类，要么含有一个有效值，要么含有一个错误的特殊对象。
+// 用于做可能出错的函数返回值，代替把正常值域里的某些特殊返回值作为错误
+// （比如常见的查找下标返回-1表示不存在等）或者抛出异常的错误处理办法。
+// 用法参见下面示例。
+template <typename T, typename ErrorType = GenericError>
+class [[nodiscard]] Result {
+public:
+    Result(T value) : value_(std::move(value)) {}
+    Result(ErrorType error) : error_(std::move(error)) {}
+    Result(const Result& src) : error_(std::move(src.error_)) {
+        if (!error_)
+            new(&value_) T(src.value_);
+    }
+    // 错误对象只拷贝不移动，否则源对象会被误认为含有值而在析构时出错。
+    // 标记 noexcept 以便 std::vector 扩容时移动而不是拷贝元素。
+    Result(Result&& src) noexcept(std::is_nothrow_move_constructible<T>::value &&
+                                  std::is_nothrow_copy_constructible<ErrorType>::value)
+        : error_(src.error_) {
+        if (!error_)
+            new(&value_) T(std::move(src.value_));
+    }
+
+    template <typename ErrorType2>
+    Result(ErrorType2 error, std::enable_if<std::is_same<ErrorType, GenericError>::value, void>* = nullptr)
+        : error_(error) {
+    }
+
+    ~Result() {
+        if (OK()) {
+            value_.~T();
+        }
+    }
+
+    T* operator->() const {
+        return &value_;
+    }
+
+    const T& Value() const {
+        return value_;
+    }
+    T& Value() {
+        return value_;
+    }
+
+    // 如果当前结果是错误，返回默认值
+    T ValueOr(T default_value) const {
+        if (OK()) return Value();
+        return default_value;
+    }
+
+    // 返回是否是成功
+    bool OK() const {
+        return !error_;
+    }
+    const ErrorType& Error() const {
+        return error_;
+    }
+private:
+    // 用 union 避免自动构造和析构，确保有错误时对象不构造
+    union {
+        T value_;
+    };
+    ErrorType error_;
+};
+
+// Void 返回值的偏特化，和普通的比缺少部分成员函数。
+template <typename ErrorType>
+class [[nodiscard]] Result<void, ErrorType> {
+public:
+    Result() {}
+    Result(ErrorType error) :error_(std::move(error)) {}
+
+    template <typename ErrorType2>
+    Result(ErrorType2 error, std::enable_if<std::is_same<ErrorType, GenericError>::value, void>* = nullptr)
+    : error_(error) {
+      }
+
+    void IgnoreError() const {}
+
+    bool OK() const {
+        return !error_;
+    }
+    const ErrorType& Error() const {
+        return error_;
+    }
+private:
+    ErrorType error_;
+};
+
+// 引用的偏特化，内部保存指针，用于返回容器里已有的元素而不拷贝。
+// 引用的对象必须在 Result 使用期间一直有效。
+template <typename T, typename ErrorType>
+class [[nodiscard]] Result<T&, ErrorType> {
+public:
+    Result(T& value) : value_(&value) {}
+    Result(ErrorType error) : value_(nullptr), error_(std::move(error)) {}
+
+    T* operator->() const {
+        return value_;
+    }
+
+    T& Value() const {
+        return *value_;
+    }
+
+    // 如果当前结果是错误，返回默认值
+    T& ValueOr(T& default_value) const {
+        if (OK()) return *value_;
+        return default_value;
+    }
+
+    bool OK() const {
+        return !error_;
+    }
+    const ErrorType& Error() const {
+        return error_;
+    }
+private:
+    T* value_;
+    ErrorType error_;
+};
+
+// 取出 Result 类型的值类型和错误类型，用于编写泛型代码
+template <typename ResultType>
+struct ResultTraits;
+
+template <typename T, typename ErrorType>
+struct ResultTraits<Result<T, ErrorType>> {
+    using ValueType = T;
+    using Error = ErrorType;
+};
+
+// 用于产生成功 Result<void> 类型的辅助函数
+inline Result<void> OK() {
+    return {};
+}
+
+// 支持嵌套错误，尚未实现
+template <typename ErrorCode, typename ErrorType>
+Result<void, ErrorCode> WrapError(ErrorCode code, ErrorCode cause) {
+    return Result<void, ErrorCode>(code, cause);
+}
+
+// TRY 的辅助函数：临时的 Result 把值移出来，这样只能移动的类型也能用 TRY；
+// 左值的 Result 以及值本身是引用的 Result 仍然拷贝，不影响原来的对象；Result<void> 没有值
+template <typename ResultType>
+decltype(auto) TryTakeValue(ResultType&& result) {
+    using ValueType = typename ResultTraits<typename std::decay<ResultType>::type>::ValueType;
+    if constexpr (std::is_void<ValueType>::value)
+        return;
+    else if constexpr (std::is_lvalue_reference<ResultType>::value || std::is_reference<ValueType>::value)
+        return (result.Value());
+    else
+        return std::move(result.Value());
+}
+
+// 也是模仿 Rust 的 TRY 宏，遇到表达式的值为错误时，自动从当前函数退出，返回错误
+// 无错误时，则返回表达式的值。具体参见下面的例子。
+//
+// 这里的实现还有几个问题：
+//   TRY 这个名字太短非常容易冲突，显然不适合正式代码，这里仅用于演示
+//   实现依赖了 GCC 的非标准扩展“语句表达式”，不可移植
+#define TRY(stmt) ({ \
+    auto&& result = stmt; \
+    if (!result.OK()) return result.Error(); \
+    TryTakeValue(std::forward<decltype(result)>(result)); \
+})
+
+#endif // ERROR_HANDLING_RESULT_H_
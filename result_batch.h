@@ -0,0 +1,228 @@
+#ifndef ERROR_HANDLING_RESULT_BATCH_H_
+#define ERROR_HANDLING_RESULT_BATCH_H_
+
+// 结构数组（SoA）形式的一批 Result<T, E>。
+//
+// std::vector<Result<int, ErrnoError>> 里值和完整的错误对象交错存放，浪费缓存，
+// 也没法向量化。ResultBatch 把它拆成三部分：
+//   - 连续的值数组，出错的位置上是 T 的默认值；
+//   - 错误位图，每个元素一位，1 表示出错；
+//   - 稀疏的错误表，按下标有序，只存放出错元素的错误对象。
+// 批量处理的代码可以直接操作值数组，再通过错误表只处理出错的那几个位置。
+// 位图上的扫描在 x86 上用 SSE2/AVX2 一次检查 128/256 位。
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "result.h"
+
+// 位图上的扫描，words 中超出有效位数的高位必须为 0
+class BitmapScan {
+public:
+    static constexpr std::size_t kNotFound = static_cast<std::size_t>(-1);
+
+    // [begin, end) 里有没有置位的
+    static bool Any(const uint64_t* words, std::size_t begin, std::size_t end) {
+        if (begin >= end) return false;
+        std::size_t first_word = begin / 64, last_word = (end - 1) / 64;
+        uint64_t head = words[first_word] & (~uint64_t(0) << (begin % 64));
+        if (first_word == last_word) return (head & TailMask(end)) != 0;
+        if (head != 0) return true;
+        if ((words[last_word] & TailMask(end)) != 0) return true;
+        return AnyWords(words + first_word + 1, last_word - first_word - 1);
+    }
+
+    // 从 begin 开始第一个置位的位置，没有时返回 kNotFound
+    static std::size_t FindFirst(const uint64_t* words, std::size_t begin, std::size_t end) {
+        if (begin >= end) return kNotFound;
+        std::size_t i = begin / 64;
+        const std::size_t last_word = (end - 1) / 64;
+        uint64_t word = words[i] & (~uint64_t(0) << (begin % 64));
+        while (word == 0) {
+            if (++i > last_word) return kNotFound;
+            // 整块为 0 的区域向量化跳过
+            i += SkipZeroWords(words + i, last_word + 1 - i);
+            if (i > last_word) return kNotFound;
+            word = words[i];
+        }
+        std::size_t bit = i * 64 + __builtin_ctzll(word);
+        return bit < end ? bit : kNotFound;
+    }
+
+    static std::size_t Count(const uint64_t* words, std::size_t num_words) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < num_words; ++i) count += __builtin_popcountll(words[i]);
+        return count;
+    }
+
+private:
+    static uint64_t TailMask(std::size_t end) {
+        return end % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (end % 64)) - 1;
+    }
+
+    static bool AnyWords(const uint64_t* words, std::size_t n) {
+        return SkipZeroWords(words, n) < n;
+    }
+
+    // 返回开头连续为 0 的字数，粒度为向量宽度，剩余部分逐字检查
+    static std::size_t SkipZeroWords(const uint64_t* words, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 4 <= n; i += 4) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+            if (!_mm256_testz_si256(v, v)) break;
+        }
+#elif defined(__SSE2__)
+        for (; i + 2 <= n; i += 2) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF) break;
+        }
+#endif
+        while (i < n && words[i] == 0) ++i;
+        return i;
+    }
+};
+
+template <typename T, typename ErrorType = GenericError>
+class ResultBatch {
+public:
+    static constexpr std::size_t kNoError = BitmapScan::kNotFound;
+
+    ResultBatch() {}
+    // n 个成功的默认值
+    explicit ResultBatch(std::size_t n) : values_(n), error_bits_((n + 63) / 64) {}
+
+    std::size_t Size() const {
+        return values_.size();
+    }
+
+    void Reserve(std::size_t n) {
+        values_.reserve(n);
+        error_bits_.reserve((n + 63) / 64);
+    }
+
+    void PushBack(Result<T, ErrorType> result) {
+        std::size_t index = values_.size();
+        if (index % 64 == 0) error_bits_.push_back(0);
+        if (result.OK()) {
+            values_.push_back(std::move(result.Value()));
+        } else {
+            values_.emplace_back();
+            MarkError(index, result.Error());
+        }
+    }
+
+    void SetValue(std::size_t index, T value) {
+        values_[index] = std::move(value);
+        if (!OK(index)) {
+            error_bits_[index / 64] &= ~(uint64_t(1) << (index % 64));
+            errors_.erase(FindError(index));
+        }
+    }
+
+    void SetError(std::size_t index, ErrorType error) {
+        values_[index] = T();
+        if (OK(index)) {
+            MarkError(index, std::move(error));
+        } else {
+            FindError(index)->second = std::move(error);
+        }
+    }
+
+    bool OK(std::size_t index) const {
+        return (error_bits_[index / 64] >> (index % 64) & 1) == 0;
+    }
+
+    const T& Value(std::size_t index) const {
+        return values_[index];
+    }
+
+    const ErrorType& Error(std::size_t index) const {
+        assert(!OK(index));
+        return FindError(index)->second;
+    }
+
+    // 还原出单个的 Result
+    Result<T, ErrorType> At(std::size_t index) const {
+        if (OK(index)) return values_[index];
+        return Error(index);
+    }
+
+    // 连续的值数组，可以直接交给向量化的代码处理
+    T* Values() {
+        return values_.data();
+    }
+    const T* Values() const {
+        return values_.data();
+    }
+
+    // 错误位图，每个 uint64_t 存放 64 个元素的状态
+    const uint64_t* ErrorBits() const {
+        return error_bits_.data();
+    }
+
+    std::size_t ErrorCount() const {
+        return errors_.size();
+    }
+    bool AllOK() const {
+        return errors_.empty();
+    }
+    bool AnyOK() const {
+        return errors_.size() < values_.size();
+    }
+
+    // [begin, end) 范围内是否全部成功
+    bool AllOK(std::size_t begin, std::size_t end) const {
+        return !BitmapScan::Any(error_bits_.data(), begin, std::min(end, Size()));
+    }
+
+    // 从 begin 开始的第一个出错的位置，没有时返回 kNoError
+    std::size_t FirstError(std::size_t begin = 0) const {
+        if (begin == 0) return errors_.empty() ? kNoError : errors_.front().first;
+        return BitmapScan::FindFirst(error_bits_.data(), begin, Size());
+    }
+
+    // 按下标顺序访问所有出错的位置，function 以 (下标, 错误) 调用
+    template <typename Function>
+    void ForEachError(Function function) const {
+        for (auto& entry : errors_) function(entry.first, entry.second);
+    }
+
+private:
+    using ErrorEntry = std::pair<std::size_t, ErrorType>;
+
+    void MarkError(std::size_t index, ErrorType error) {
+        error_bits_[index / 64] |= uint64_t(1) << (index % 64);
+        // 通常按下标顺序设置错误，这时直接追加
+        if (errors_.empty() || errors_.back().first < index) {
+            errors_.emplace_back(index, std::move(error));
+        } else {
+            auto it = std::lower_bound(errors_.begin(), errors_.end(), index,
+                                       [](const ErrorEntry& e, std::size_t i) { return e.first < i; });
+            errors_.emplace(it, index, std::move(error));
+        }
+    }
+
+    typename std::vector<ErrorEntry>::iterator FindError(std::size_t index) {
+        return std::lower_bound(errors_.begin(), errors_.end(), index,
+                                [](const ErrorEntry& e, std::size_t i) { return e.first < i; });
+    }
+    typename std::vector<ErrorEntry>::const_iterator FindError(std::size_t index) const {
+        return std::lower_bound(errors_.begin(), errors_.end(), index,
+                                [](const ErrorEntry& e, std::size_t i) { return e.first < i; });
+    }
+
+    std::vector<T> values_;
+    std::vector<uint64_t> error_bits_;
+    std::vector<ErrorEntry> errors_;
+};
+
+#endif // ERROR_HANDLING_RESULT_BATCH_H_
@@ -0,0 +1,195 @@
+#ifndef ERROR_HANDLING_RESULT_CORO_H_
+#define ERROR_HANDLING_RESULT_CORO_H_
+
+// 用 C++20 协程实现 TRY 的功能，不再依赖 GCC 的语句表达式扩展。
+//
+// 返回 Result 的函数只要用了 co_await/co_return 就成为协程：
+//
+//   Result<int> GetIntFromFile(const std::string& filename) {
+//       auto f = co_await OpenFile(filename);  // 出错时直接结束协程，返回错误
+//       auto s = co_await f.Read();
+//       co_return co_await ParseInt(s);
+//   }
+//
+// 协程是同步执行的：initial_suspend 和 final_suspend 都不挂起，遇到错误时在
+// await_suspend 里把错误写入返回值并销毁协程帧，控制流直接回到调用者。
+//
+// 编译器如果能证明协程帧的生命期不超出调用者，可以把它分配在调用者的栈上
+// （HALO）。GCC 目前不做这个优化，因此这里用一个线程局部的帧缓存来
+// 复用协程帧的内存，避免每次调用都走一遍 malloc/free。
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "result.h"
+
+// 线程局部的协程帧缓存，按大小精确匹配，后进先出。
+// 同步协程的帧总是按调用栈的顺序分配和释放，所以命中率很高。
+class CoroutineFrameCache {
+public:
+    static void* Allocate(std::size_t size) {
+        FreeList& list = Instance();
+        for (int i = list.count - 1; i >= 0; --i) {
+            if (list.sizes[i] == size) {
+                void* p = list.blocks[i];
+                --list.count;
+                list.blocks[i] = list.blocks[list.count];
+                list.sizes[i] = list.sizes[list.count];
+                return p;
+            }
+        }
+        void* p = std::malloc(size);
+        if (p == nullptr) throw std::bad_alloc();
+        return p;
+    }
+
+    static void Deallocate(void* p, std::size_t size) {
+        FreeList& list = Instance();
+        if (list.count == kCapacity) {
+            std::free(p);
+            return;
+        }
+        list.blocks[list.count] = p;
+        list.sizes[list.count] = size;
+        ++list.count;
+    }
+
+private:
+    static constexpr int kCapacity = 64;
+    struct FreeList {
+        void* blocks[kCapacity];
+        std::size_t sizes[kCapacity];
+        int count = 0;
+        ~FreeList() {
+            for (int i = 0; i < count; ++i) std::free(blocks[i]);
+        }
+    };
+    static FreeList& Instance() {
+        static thread_local FreeList list;
+        return list;
+    }
+};
+
+// 返回 Result 的协程的 promise 公共部分。
+// 协程的返回值存放在 ReturnObject 里，它位于调用者的栈上，promise 只持有指针。
+// ReturnObject 到 Result 的转换发生在协程第一次返回调用者的时候（GCC 和
+// Clang 都是如此），那时协程已经执行完毕，结果一定已经写入。
+template <typename T, typename ErrorType>
+class ResultPromiseBase {
+public:
+    class ReturnObject {
+    public:
+        explicit ReturnObject(ResultPromiseBase* promise) {
+            promise->slot_ = &slot_;
+        }
+        ReturnObject(const ReturnObject&) = delete;
+        ReturnObject& operator=(const ReturnObject&) = delete;
+
+        operator Result<T, ErrorType>() {
+            return std::move(*slot_);
+        }
+
+    private:
+        std::optional<Result<T, ErrorType>> slot_;
+    };
+
+    ReturnObject get_return_object() {
+        return ReturnObject(this);
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void unhandled_exception() { throw; }
+
+    // 由 ResultAwaiter 在遇到错误时调用，写入错误后销毁协程帧，
+    // 返回的句柄表示接下来要恢复执行的协程，这里直接回到调用者。
+    template <typename ErrorType2>
+    std::coroutine_handle<> ReturnError(std::coroutine_handle<> handle, ErrorType2&& error) {
+        slot_->emplace(ErrorType(std::forward<ErrorType2>(error)));
+        handle.destroy();
+        return std::noop_coroutine();
+    }
+
+    static void* operator new(std::size_t size) {
+        return CoroutineFrameCache::Allocate(size);
+    }
+    static void operator delete(void* p, std::size_t size) {
+        CoroutineFrameCache::Deallocate(p, size);
+    }
+
+protected:
+    std::optional<Result<T, ErrorType>>* slot_ = nullptr;
+};
+
+template <typename T, typename ErrorType>
+class ResultPromise : public ResultPromiseBase<T, ErrorType> {
+public:
+    template <typename U>
+    void return_value(U&& value) {
+        this->slot_->emplace(std::forward<U>(value));
+    }
+};
+
+template <typename ErrorType>
+class ResultPromise<void, ErrorType> : public ResultPromiseBase<void, ErrorType> {
+public:
+    void return_void() {
+        this->slot_->emplace();
+    }
+};
+
+template <typename T, typename ErrorType, typename... Args>
+struct std::coroutine_traits<Result<T, ErrorType>, Args...> {
+    using promise_type = ResultPromise<T, ErrorType>;
+};
+
+// co_await 一个 Result：成功时得到其中的值，失败时结束当前协程并返回错误。
+// ResultType 是 Result<T, E>&（等待左值）或者 Result<T, E>（等待右值）。
+// 当前协程的 promise 需要提供 ReturnError(handle, error)，错误类型可以不同，只要能转换。
+// ReturnError 负责结束当前协程，并返回接下来要恢复的协程。
+template <typename ResultType>
+class ResultAwaiter {
+public:
+    explicit ResultAwaiter(ResultType result) : result_(std::forward<ResultType>(result)) {}
+
+    bool await_ready() const noexcept {
+        return result_.OK();
+    }
+
+    // 协程帧可能被销毁，本对象也随之不存在，调用 ReturnError 后不能再访问任何成员
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) {
+        return handle.promise().ReturnError(handle, result_.Error());
+    }
+
+    // 等待右值时把值移出来，等待左值时返回引用
+    decltype(auto) await_resume() {
+        if constexpr (std::is_void_v<ValueType>) {
+            return;
+        } else if constexpr (std::is_lvalue_reference_v<ResultType>) {
+            return static_cast<ValueType&>(result_.Value());
+        } else {
+            return ValueType(std::move(result_.Value()));
+        }
+    }
+
+private:
+    using ValueType = typename ResultTraits<std::remove_cvref_t<ResultType>>::ValueType;
+    ResultType result_;
+};
+
+template <typename T, typename ErrorType>
+ResultAwaiter<Result<T, ErrorType>&> operator co_await(Result<T, ErrorType>& result) {
+    return ResultAwaiter<Result<T, ErrorType>&>(result);
+}
+
+template <typename T, typename ErrorType>
+ResultAwaiter<Result<T, ErrorType>> operator co_await(Result<T, ErrorType>&& result) {
+    return ResultAwaiter<Result<T, ErrorType>>(std::move(result));
+}
+
+#endif // ERROR_HANDLING_RESULT_CORO_H_
@@ -0,0 +1,250 @@
+#ifndef ERROR_HANDLING_RETRY_H_
+#define ERROR_HANDLING_RETRY_H_
+
+// 按错误的类别重试返回 Result 的函数：
+//
+//   Result<Response, RpcError> r = Retry([&] { return Call<Request, Response>(request); });
+//
+// 每次失败后用 RetryTraits<E>::Classify 判断错误的类别：永久错误（参数错、不存在等）
+// 立即返回；暂时性错误按指数退避加随机抖动（full jitter）后重试；被限流的错误也重试，
+// 但至少等待退避时间的一半，不会立即重试。各个错误域特化 RetryTraits 给出自己的分类，比如
+//
+//   template <>
+//   struct RetryTraits<RpcError> {
+//       static ErrorClass Classify(const RpcError& e) {
+//           return e.Code() == RpcErrorCode::FAILED ? ErrorClass::kTransient : ErrorClass::kPermanent;
+//       }
+//   };
+//
+// 没有特化的错误类型都当作永久错误，不会重试。
+//
+// 为了防止依赖出故障时大量重试把负载放大（重试风暴），重试要从一个全进程共享的
+// 令牌桶（RetryBudget）里取令牌：每次调用存入一定比例的令牌，另外按时间补充少量令牌，
+// 每次重试取走一个，取不到时不再重试，直接返回最后的错误。
+// 第一次就成功的常见路径不加锁，也不写共享的变量：存入的令牌先在线程局部累计，
+// 攒够一批再一次加到桶里。
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "cancellation.h"
+#include "errno_error.h"
+#include "result.h"
+
+enum class ErrorClass {
+    kPermanent,  // 重试也不会成功
+    kTransient,  // 暂时性的故障，稍后重试可能成功
+    kThrottled,  // 对方要求降低请求速率
+};
+
+// 错误的分类，各个错误类型可以特化
+template <typename ErrorType>
+struct RetryTraits {
+    static ErrorClass Classify(const ErrorType&) {
+        return ErrorClass::kPermanent;
+    }
+};
+
+// 按 errno 分类
+inline ErrorClass ClassifyErrno(int code) {
+    switch (code) {
+        case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+        case EWOULDBLOCK:
+#endif
+        case EINTR:
+        case ETIMEDOUT:
+        case ECONNRESET:
+        case ECONNREFUSED:
+        case ECONNABORTED:
+        case EHOSTUNREACH:
+        case ENETUNREACH:
+        case ENETDOWN:
+        case EPIPE:
+        case EIO:
+            return ErrorClass::kTransient;
+        case EBUSY:
+        case ENOBUFS:
+        case EMFILE:
+        case ENFILE:
+        case EUSERS:
+            return ErrorClass::kThrottled;
+        default:
+            return ErrorClass::kPermanent;
+    }
+}
+
+template <>
+struct RetryTraits<ErrnoError> {
+    static ErrorClass Classify(const ErrnoError& error) {
+        return ClassifyErrno(static_cast<int>(error.Code()));
+    }
+};
+
+template <>
+struct RetryTraits<GenericError> {
+    // 只有错误码是 errno 的错误（直接用 int 构造的或者从 ErrnoError 转换来的）才按 errno 分类，
+    // 从其他 TypedError 转换来的错误码含义不同，当作永久错误
+    static ErrorClass Classify(const GenericError& error) {
+        const int domain = error.Domain();
+        if (domain != ErrorDomain<int>() && domain != ErrorDomain<ErrnoType>()) return ErrorClass::kPermanent;
+        return ClassifyErrno(error.Code());
+    }
+};
+
+// 全进程共享的重试令牌桶。令牌以千分之一为单位保存在一个原子整数里，
+// 取令牌是一个 CAS 循环，按时间补充由抢到更新时间戳的线程负责。
+class RetryBudget {
+public:
+    // 每次调用存入 ratio 个令牌，另外每秒补充 min_per_second 个，最多存 max_tokens 个
+    explicit RetryBudget(double ratio = 0.1, double min_per_second = 10, double max_tokens = 100)
+        : id_(NextId()),
+          deposit_per_call_(static_cast<int64_t>(ratio * kScale)),
+          refill_per_second_(static_cast<int64_t>(min_per_second * kScale)),
+          capacity_(static_cast<int64_t>(max_tokens * kScale)),
+          tokens_(capacity_),
+          last_refill_(NowNanos()) {}
+
+    RetryBudget(const RetryBudget&) = delete;
+    RetryBudget& operator=(const RetryBudget&) = delete;
+
+    // 默认使用的全局预算
+    static RetryBudget& Global() {
+        static RetryBudget budget;
+        return budget;
+    }
+
+    // 记录一次调用。先在线程局部累计，每 kBatch 次调用才访问一次共享的令牌数。
+    // 每个线程按预算的编号分几个累计位置，两个预算映射到同一个位置时，
+    // 后来的预算丢掉前一个还没攒够一批的调用，不会把它们记到自己名下。
+    void OnCall() {
+        static thread_local PendingCalls pending[kPendingSlots];
+        PendingCalls& p = pending[id_ % kPendingSlots];
+        if (p.budget != id_) p = PendingCalls{id_, 0};
+        if (++p.calls < kBatch) return;
+        p.calls = 0;
+        Add(deposit_per_call_ * kBatch);
+    }
+
+    // 取一个令牌，返回是否允许重试
+    bool TryWithdraw() {
+        Refill();
+        int64_t tokens = tokens_.load(std::memory_order_relaxed);
+        while (tokens >= kScale) {
+            if (tokens_.compare_exchange_weak(tokens, tokens - kScale, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    double Tokens() const {
+        return static_cast<double>(tokens_.load(std::memory_order_relaxed)) / kScale;
+    }
+
+private:
+    static constexpr int64_t kScale = 1000;
+    static constexpr uint32_t kBatch = 16;
+    static constexpr std::size_t kPendingSlots = 4;
+
+    struct PendingCalls {
+        uint64_t budget = 0;  // 预算的编号，0 表示空
+        uint32_t calls = 0;
+    };
+
+    // 每个预算一个从 1 开始的编号，预算销毁后也不会重用，线程局部的累计不会记错对象
+    static uint64_t NextId() {
+        static std::atomic<uint64_t> next{0};
+        return next.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    static int64_t NowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void Refill() {
+        const int64_t now = NowNanos();
+        int64_t last = last_refill_.load(std::memory_order_relaxed);
+        // 至少间隔 1ms 才补充，避免每次重试都争抢时间戳
+        if (now - last < 1000000) return;
+        if (!last_refill_.compare_exchange_strong(last, now, std::memory_order_relaxed)) return;
+        Add(static_cast<int64_t>(static_cast<double>(now - last) * refill_per_second_ / 1e9));
+    }
+
+    void Add(int64_t amount) {
+        int64_t tokens = tokens_.fetch_add(amount, std::memory_order_relaxed) + amount;
+        // 超出容量时削回容量，和其他线程的增减交错也不会少于容量
+        while (tokens > capacity_ &&
+               !tokens_.compare_exchange_weak(tokens, capacity_, std::memory_order_relaxed)) {
+        }
+    }
+
+    const uint64_t id_;
+    const int64_t deposit_per_call_;
+    const int64_t refill_per_second_;
+    const int64_t capacity_;
+    alignas(64) std::atomic<int64_t> tokens_;
+    alignas(64) std::atomic<int64_t> last_refill_;
+};
+
+struct RetryPolicy {
+    int max_attempts = 3;  // 包括第一次调用
+    std::chrono::nanoseconds initial_backoff = std::chrono::milliseconds(10);
+    std::chrono::nanoseconds max_backoff = std::chrono::seconds(1);
+    double multiplier = 2.0;
+    RetryBudget* budget = &RetryBudget::Global();  // 为空时不限制重试
+    CancellationToken cancellation;                // 取消后不再重试
+};
+
+namespace retry_internal {
+
+// 线程局部的 xorshift 随机数，抖动不需要高质量的随机数
+inline uint64_t NextRandom() {
+    static thread_local uint64_t state =
+        (reinterpret_cast<uintptr_t>(&state) ^
+         static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// 第 retry 次重试前等待的时间
+inline std::chrono::nanoseconds Backoff(const RetryPolicy& policy, int retry, ErrorClass error_class) {
+    double ceiling = static_cast<double>(policy.initial_backoff.count());
+    for (int i = 1; i < retry && ceiling < policy.max_backoff.count(); ++i) ceiling *= policy.multiplier;
+    if (ceiling > policy.max_backoff.count()) ceiling = static_cast<double>(policy.max_backoff.count());
+    const double unit = static_cast<double>(NextRandom() >> 11) / static_cast<double>(uint64_t(1) << 53);
+    // 限流时在 [ceiling/2, ceiling) 里取，否则在 [0, ceiling) 里取
+    const double wait = error_class == ErrorClass::kThrottled ? ceiling * (0.5 + unit / 2) : ceiling * unit;
+    return std::chrono::nanoseconds(static_cast<int64_t>(wait));
+}
+
+} // namespace retry_internal
+
+// 调用 function()，按 policy 重试失败的调用，返回最后一次的结果。
+// 等待期间阻塞当前线程。
+template <typename Function>
+std::invoke_result_t<Function&> Retry(Function&& function, const RetryPolicy& policy = {}) {
+    using ResultType = std::invoke_result_t<Function&>;
+    using ErrorType = typename ResultTraits<ResultType>::Error;
+    if (policy.budget != nullptr) policy.budget->OnCall();
+    for (int attempt = 1;; ++attempt) {
+        ResultType result = function();
+        if (result.OK()) return result;
+        const ErrorClass error_class = RetryTraits<ErrorType>::Classify(result.Error());
+        if (error_class == ErrorClass::kPermanent || attempt >= policy.max_attempts) return result;
+        if (policy.cancellation.IsCancelled()) return result;
+        if (policy.budget != nullptr && !policy.budget->TryWithdraw()) return result;
+        std::this_thread::sleep_for(retry_internal::Backoff(policy, attempt, error_class));
+    }
+}
+
+#endif // ERROR_HANDLING_RETRY_H_
@@ -0,0 +1,68 @@
+#ifndef ERROR_HANDLING_SPIN_WAIT_H_
+#define ERROR_HANDLING_SPIN_WAIT_H_
+
+// 忙等待相关的小工具
+
+#include <chrono>
+#include <thread>
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// 自适应自旋：自旋等到了就增加下次的自旋次数，最终还是要睡眠就减少。
+class AdaptiveSpin {
+public:
+    template <typename Predicate>
+    static bool SpinUntil(Predicate predicate) {
+        // 单核上自旋只会占住对方需要的 CPU
+        static const bool single_cpu = std::thread::hardware_concurrency() <= 1;
+        if (single_cpu) return predicate();
+        int& limit = Limit();
+        for (int i = 0; i < limit; ++i) {
+            if (predicate()) {
+                if (limit < kMaxSpins) limit *= 2;
+                return true;
+            }
+            CpuRelax();
+        }
+        if (limit > kMinSpins) limit /= 2;
+        return predicate();
+    }
+
+private:
+    static constexpr int kMinSpins = 16;
+    static constexpr int kMaxSpins = 4096;
+
+    static int& Limit() {
+        static thread_local int limit = 256;
+        return limit;
+    }
+};
+
+// 轮询等待时的退避：先自旋，再让出 CPU，最后短暂睡眠
+class Backoff {
+public:
+    void Pause() {
+        if (count_ < 16)
+            CpuRelax();
+        else if (count_ < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        ++count_;
+    }
+
+    void Reset() {
+        count_ = 0;
+    }
+
+private:
+    int count_ = 0;
+};
+
+#endif // ERROR_HANDLING_SPIN_WAIT_H_
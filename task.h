@@ -0,0 +1,241 @@
+#ifndef ERROR_HANDLING_TASK_H_
+#define ERROR_HANDLING_TASK_H_
+
+// 异步任务 Task<T, E>，完成时的结果是一个 Result<T, E>。
+//
+// Task 是惰性的，创建后不会运行，直到被 co_await、SyncWait 或者 Spawn。
+// 在 Task 里：
+//   co_await pool.Schedule();           // 转移到线程池里执行
+//   auto v = co_await SomeTask();       // 等待子任务，出错时当前任务以同样的错误结束
+//   auto r = co_await SomeTask().AsResult();  // 等待子任务，拿到完整的 Result，不传播错误
+//   auto n = co_await ParseInt(s);      // 同步的 Result 也一样可以等待
+// 错误的传播全程不使用异常。
+
+#include <condition_variable>
+#include <coroutine>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "result.h"
+#include "result_coro.h"
+
+template <typename T, typename ErrorType>
+class Task;
+
+template <typename T, typename ErrorType>
+class TaskPromiseBase {
+public:
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept {
+                return promise->Complete();
+            }
+            void await_resume() const noexcept {}
+            TaskPromiseBase* promise;
+        };
+        return FinalAwaiter{this};
+    }
+
+    void unhandled_exception() { throw; }
+
+    // 遇到错误时结束任务，协程帧留给 Task 对象销毁
+    template <typename ErrorType2>
+    std::coroutine_handle<> ReturnError(std::coroutine_handle<>, ErrorType2&& error) {
+        result_.emplace(ErrorType(std::forward<ErrorType2>(error)));
+        return Complete();
+    }
+
+    static void* operator new(std::size_t size) {
+        return CoroutineFrameCache::Allocate(size);
+    }
+    static void operator delete(void* p, std::size_t size) {
+        CoroutineFrameCache::Deallocate(p, size);
+    }
+
+protected:
+    template <typename T2, typename ErrorType2>
+    friend class Task;
+
+    using Propagate = std::coroutine_handle<> (*)(std::coroutine_handle<>, const ErrorType&);
+
+    // 任务结束，返回接下来要恢复的协程。如果等待者要求传播错误，
+    // 等待者会直接以同样的错误结束，而不再被恢复。
+    std::coroutine_handle<> Complete() noexcept {
+        if (!continuation_) return std::noop_coroutine();
+        if (propagate_ != nullptr && !result_->OK())
+            return propagate_(continuation_, result_->Error());
+        return continuation_;
+    }
+
+    std::optional<Result<T, ErrorType>> result_;
+    std::coroutine_handle<> continuation_;
+    Propagate propagate_ = nullptr;
+};
+
+template <typename T, typename ErrorType>
+class TaskPromise : public TaskPromiseBase<T, ErrorType> {
+public:
+    Task<T, ErrorType> get_return_object();
+
+    template <typename U>
+    void return_value(U&& value) {
+        this->result_.emplace(std::forward<U>(value));
+    }
+};
+
+template <typename ErrorType>
+class TaskPromise<void, ErrorType> : public TaskPromiseBase<void, ErrorType> {
+public:
+    Task<void, ErrorType> get_return_object();
+
+    void return_void() {
+        this->result_.emplace();
+    }
+};
+
+template <typename T, typename ErrorType = GenericError>
+class [[nodiscard]] Task {
+public:
+    using promise_type = TaskPromise<T, ErrorType>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() {}
+    explicit Task(Handle handle) : handle_(handle) {}
+    Task(Task&& src) noexcept : handle_(std::exchange(src.handle_, {})) {}
+    Task& operator=(Task&& src) noexcept {
+        if (this != &src) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(src.handle_, {});
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool Valid() const {
+        return static_cast<bool>(handle_);
+    }
+
+    // 等待任务完成，成功时得到值，失败时当前任务以同样的错误结束
+    auto operator co_await() && {
+        return Awaiter<true>(handle_);
+    }
+
+    // 等待任务完成，得到完整的 Result
+    auto AsResult() && {
+        return Awaiter<false>(handle_);
+    }
+
+private:
+    template <bool kPropagate>
+    class Awaiter {
+    public:
+        explicit Awaiter(Handle handle) : handle_(handle) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> waiter) noexcept {
+            auto& promise = handle_.promise();
+            promise.continuation_ = waiter;
+            if constexpr (kPropagate) {
+                promise.propagate_ = [](std::coroutine_handle<> h, const ErrorType& error) {
+                    auto typed = std::coroutine_handle<Promise>::from_address(h.address());
+                    return typed.promise().ReturnError(typed, error);
+                };
+            }
+            return handle_;
+        }
+
+        decltype(auto) await_resume() {
+            auto& result = *handle_.promise().result_;
+            if constexpr (!kPropagate) {
+                return Result<T, ErrorType>(std::move(result));
+            } else if constexpr (!std::is_void_v<T>) {
+                return T(std::move(result.Value()));
+            }
+        }
+
+    private:
+        Handle handle_;
+    };
+
+    Handle handle_;
+};
+
+template <typename T, typename ErrorType>
+Task<T, ErrorType> TaskPromise<T, ErrorType>::get_return_object() {
+    return Task<T, ErrorType>(Task<T, ErrorType>::Handle::from_promise(*this));
+}
+
+template <typename ErrorType>
+Task<void, ErrorType> TaskPromise<void, ErrorType>::get_return_object() {
+    return Task<void, ErrorType>(Task<void, ErrorType>::Handle::from_promise(*this));
+}
+
+// 不需要等待的协程，开始后立即执行，结束时自动销毁协程帧。
+// 用于在普通函数和 Task 之间搭桥。
+class DetachedTask {
+public:
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(std::size_t size) {
+            return CoroutineFrameCache::Allocate(size);
+        }
+        static void operator delete(void* p, std::size_t size) {
+            CoroutineFrameCache::Deallocate(p, size);
+        }
+    };
+};
+
+template <typename Executor, typename T, typename ErrorType, typename Callback>
+DetachedTask SpawnDetached(Executor& executor, Task<T, ErrorType> task, Callback callback) {
+    co_await executor.Schedule();
+    callback(co_await std::move(task).AsResult());
+}
+
+// 在 executor 里运行 task，完成后在执行它的线程里以 Result<T, E> 调用 callback
+template <typename Executor, typename T, typename ErrorType, typename Callback>
+void Spawn(Executor& executor, Task<T, ErrorType> task, Callback callback) {
+    SpawnDetached(executor, std::move(task), std::move(callback));
+}
+
+struct SyncWaitEvent {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+};
+
+template <typename T, typename ErrorType>
+DetachedTask SyncWaitDetached(Task<T, ErrorType> task, SyncWaitEvent& event,
+                              std::optional<Result<T, ErrorType>>& result) {
+    result.emplace(co_await std::move(task).AsResult());
+    // 在锁内通知，保证等待者返回（event 被销毁）前这里已经不再访问它
+    std::lock_guard<std::mutex> lock(event.mutex);
+    event.done = true;
+    event.cv.notify_one();
+}
+
+// 在当前线程里启动任务并阻塞等待它完成。任务可以中途转移到其他线程执行。
+template <typename T, typename ErrorType>
+Result<T, ErrorType> SyncWait(Task<T, ErrorType> task) {
+    SyncWaitEvent event;
+    std::optional<Result<T, ErrorType>> result;
+    SyncWaitDetached(std::move(task), event, result);
+    std::unique_lock<std::mutex> lock(event.mutex);
+    event.cv.wait(lock, [&] { return event.done; });
+    return std::move(*result);
+}
+
+#endif // ERROR_HANDLING_TASK_H_
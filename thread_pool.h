@@ -0,0 +1,230 @@
+#ifndef ERROR_HANDLING_THREAD_POOL_H_
+#define ERROR_HANDLING_THREAD_POOL_H_
+
+// 调度协程用的工作窃取线程池。
+//
+// 每个工作线程有自己的双端队列，只有自己从底部压入和弹出，其他线程从顶部窃取，
+// 因此大多数情况下不需要加锁。非工作线程提交的任务先放到一个全局队列里。
+// 队列元素就是协程句柄，普通函数可以包装成协程再提交（见 task.h 的 Spawn）。
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Chase-Lev 工作窃取双端队列，参见 Lê et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", PPoPP 2013。
+// Push/Pop 只能由所有者线程调用，Steal 可以由任意线程调用。
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(int64_t capacity = 256)
+        : array_(new Array(capacity)) {
+        retired_.emplace_back(array_.load(std::memory_order_relaxed));
+    }
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    void Push(void* item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) a = Grow(a, t, b);
+        a->Put(b, item);
+        bottom_.store(b + 1, std::memory_order_release);
+    }
+
+    // 队列为空时返回 nullptr
+    void* Pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        void* item = a->Get(b);
+        if (t == b) {
+            // 只剩最后一个元素，和窃取者竞争
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed))
+                item = nullptr;
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // 队列为空或者竞争失败时返回 nullptr
+    void* Steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Array* a = array_.load(std::memory_order_acquire);
+        void* item = a->Get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+private:
+    struct Array {
+        explicit Array(int64_t n) : capacity(n), mask(n - 1), items(new std::atomic<void*>[n]) {}
+        void* Get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void Put(int64_t i, void* item) { items[i & mask].store(item, std::memory_order_relaxed); }
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<void*>[]> items;
+    };
+
+    // 窃取者可能还在读旧数组，所以旧数组保留到队列销毁时才释放
+    Array* Grow(Array* old, int64_t top, int64_t bottom) {
+        Array* a = new Array(old->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i) a->Put(i, old->Get(i));
+        retired_.emplace_back(a);
+        array_.store(a, std::memory_order_release);
+        return a;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Array*> array_;
+    std::vector<std::unique_ptr<Array>> retired_;
+};
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads = std::thread::hardware_concurrency()) {
+        if (num_threads < 1) num_threads = 1;
+        for (int i = 0; i < num_threads; ++i)
+            workers_.emplace_back(std::make_unique<Worker>());
+        for (int i = 0; i < num_threads; ++i)
+            workers_[i]->thread = std::thread([this, i] { Run(i); });
+    }
+
+    // 等待所有已提交的协程执行完（或挂起在别处）后退出
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) worker->thread.join();
+    }
+
+    int Size() const {
+        return static_cast<int>(workers_.size());
+    }
+
+    // 当前线程是不是本线程池的工作线程
+    bool InWorkerThread() const {
+        return Current().pool == this;
+    }
+
+    // 在线程池中恢复执行一个协程。
+    // 在工作线程里调用时放到本线程的队列里，否则放到全局队列里。
+    void Post(std::coroutine_handle<> handle) {
+        const CurrentWorker& current = Current();
+        if (current.pool == this) {
+            workers_[current.index]->deque.Push(handle.address());
+        } else {
+            std::lock_guard<std::mutex> lock(mutex_);
+            global_.push_back(handle);
+        }
+        pending_.fetch_add(1, std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_one();
+        }
+    }
+
+    // co_await pool.Schedule() 把当前协程转移到线程池中继续执行
+    auto Schedule() {
+        struct Awaiter {
+            ThreadPool* pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { pool->Post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+private:
+    struct Worker {
+        WorkStealingDeque deque;
+        std::thread thread;
+    };
+
+    struct CurrentWorker {
+        ThreadPool* pool = nullptr;
+        int index = 0;
+    };
+
+    static CurrentWorker& Current() {
+        static thread_local CurrentWorker current;
+        return current;
+    }
+
+    void* FindWork(int index, uint64_t& rng) {
+        if (void* item = workers_[index]->deque.Pop()) return item;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!global_.empty()) {
+                void* item = global_.front().address();
+                global_.pop_front();
+                return item;
+            }
+        }
+        // 从随机位置开始依次尝试窃取其他线程的任务
+        const int n = Size();
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        const int start = static_cast<int>(rng % n);
+        for (int i = 0; i < n; ++i) {
+            int victim = (start + i) % n;
+            if (victim == index) continue;
+            if (void* item = workers_[victim]->deque.Steal()) return item;
+        }
+        return nullptr;
+    }
+
+    void Run(int index) {
+        Current() = CurrentWorker{this, index};
+        uint64_t rng = 0x9E3779B97F4A7C15ull * (index + 1);
+        for (;;) {
+            uint64_t pending = pending_.load(std::memory_order_seq_cst);
+            if (void* item = FindWork(index, rng)) {
+                std::coroutine_handle<>::from_address(item).resume();
+                continue;
+            }
+            // 先登记为休眠再检查 pending_，和 Post 中先增加 pending_ 再检查 sleeping_
+            // 配合，保证不会丢失唤醒。
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleeping_.fetch_add(1, std::memory_order_seq_cst);
+            cv_.wait(lock, [&] {
+                return stopping_ || pending_.load(std::memory_order_seq_cst) != pending;
+            });
+            sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+            if (stopping_ && pending_.load(std::memory_order_seq_cst) == pending) break;
+        }
+        Current() = CurrentWorker{};
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> global_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> pending_{0};
+    std::atomic<int> sleeping_{0};
+};
+
+#endif // ERROR_HANDLING_THREAD_POOL_H_
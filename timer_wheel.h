@@ -0,0 +1,388 @@
+#ifndef ERROR_HANDLING_TIMER_WHEEL_H_
+#define ERROR_HANDLING_TIMER_WHEEL_H_
+
+// 分层时间轮，用来给大量进行中的操作设置超时：
+//
+//   TimerService timers;                                   // 1ms 一个刻度，有自己的线程
+//   TimerId id = timers.ScheduleAfter(std::chrono::seconds(1), [] { ... });
+//   timers.Cancel(id);                                     // 操作先完成了，取消超时
+//
+// 超时以 DeadlineExceeded 错误出现在 Result 里，对 Future 和 Task 的包装见 deadline.h。
+//
+// 第 0 层有 256 个槽位，每个槽位是一个刻度；往上 4 层各 64 个槽位，每层的一个槽位
+// 覆盖下一层的一整圈，总共能表示 2^32 个刻度，1ms 的刻度约 49 天，更远的先放在最高层。
+// 定时器是双向链表的节点，放入和取消都是 O(1)。第 0 层转完一圈时把上一层的当前槽位
+// 整个取下来按剩余时间重新放入（级联），每个定时器最多级联 4 次。
+// 节点放在一个数组里按下标链接，用空闲链表复用，100 万个定时器只有几次数组扩容，
+// 没有逐个的内存分配；TimerId 带有版本号，取消已经到期或复用的节点是安全的。
+// 第 0 层另有一个位图记录非空的槽位，推进时间时直接跳过空的槽位。
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "result.h"
+
+enum class DeadlineErrorCode {
+    kDeadlineExceeded = 1,
+};
+
+using DeadlineExceeded = TypedError<DeadlineErrorCode>;
+
+struct TimerId {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+// 单线程的时间轮，时间由调用者推进。多线程使用见下面的 TimerService。
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // fire 为 true 表示到期，为 false 表示被取消或者时间轮被销毁，两种情况都要释放 context
+    using Callback = void (*)(void* context, bool fire);
+
+    // 从时间轮里取下的回调，由取下它的一方决定在哪里调用
+    struct Entry {
+        Callback callback;
+        void* context;
+
+        void Fire() const {
+            callback(context, true);
+        }
+        void Discard() const {
+            callback(context, false);
+        }
+    };
+
+    explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1), Clock::time_point start = Clock::now())
+        : tick_(tick), start_(start), heads_(kLists, kNil) {}
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    ~TimerWheel() {
+        for (uint32_t list = 0; list < kLists; ++list) {
+            while (heads_[list] != kNil) Remove(heads_[list]).Discard();
+        }
+    }
+
+    // deadline 所在的刻度结束后到期，已经过去的 deadline 在下一次推进时到期
+    TimerId Schedule(Clock::time_point deadline, Callback callback, void* context) {
+        const uint32_t index = Allocate();
+        Node& node = nodes_[index];
+        node.expiry = std::max(TickAtOrAfter(deadline), now_tick_ + 1);
+        node.callback = callback;
+        node.context = context;
+        Link(index);
+        ++size_;
+        return TimerId{index, node.generation};
+    }
+
+    // 到期时调用 function()，取消时只销毁它
+    template <typename Function>
+    TimerId Schedule(Clock::time_point deadline, Function function) {
+        return Schedule(
+            deadline,
+            [](void* context, bool fire) {
+                auto* f = static_cast<Function*>(context);
+                if (fire) (*f)();
+                delete f;
+            },
+            new Function(std::move(function)));
+    }
+
+    // 取下还没有到期的定时器，不调用回调。已经到期或者取消过的返回 std::nullopt
+    std::optional<Entry> Take(TimerId id) {
+        if (id.index >= nodes_.size()) return std::nullopt;
+        const Node& node = nodes_[id.index];
+        if (node.generation != id.generation || node.callback == nullptr) return std::nullopt;
+        return Remove(id.index);
+    }
+
+    // 返回 true 表示回调不会再以到期调用
+    bool Cancel(TimerId id) {
+        auto entry = Take(id);
+        if (!entry) return false;
+        entry->Discard();
+        return true;
+    }
+
+    // 把时间推进到 now，依次以 Entry 调用 sink 处理到期的定时器，返回到期的个数。
+    // sink 里可以放入和取消定时器。
+    template <typename Sink>
+    std::size_t Advance(Clock::time_point now, Sink sink) {
+        const uint64_t target = TickAtOrBefore(now);
+        std::size_t fired = 0;
+        while (now_tick_ < target) {
+            if (size_ == 0) {
+                now_tick_ = target;
+                break;
+            }
+            uint64_t tick = now_tick_ + 1;
+            if ((tick & kLevel0Mask) != 0) {
+                // 到这一圈结束前，只需要停在非空的槽位上
+                const uint64_t end = std::min((now_tick_ | kLevel0Mask) + 1, target + 1);
+                tick = NextOccupied(tick, end);
+                if (tick > target) {
+                    now_tick_ = target;
+                    break;
+                }
+            }
+            now_tick_ = tick;
+            if ((tick & kLevel0Mask) == 0) Cascade(tick);
+            const uint32_t slot = static_cast<uint32_t>(tick & kLevel0Mask);
+            while (heads_[slot] != kNil) {
+                sink(Remove(heads_[slot]));
+                ++fired;
+            }
+        }
+        return fired;
+    }
+
+    std::size_t Advance(Clock::time_point now) {
+        return Advance(now, [](const Entry& entry) { entry.Fire(); });
+    }
+
+    // 下一次需要推进的时间：最近的非空刻度，或者下一次级联。没有定时器时返回 time_point::max()
+    Clock::time_point NextWakeup() const {
+        if (size_ == 0) return Clock::time_point::max();
+        const uint64_t end = (now_tick_ | kLevel0Mask) + 1;
+        return TimeOfTick(NextOccupied(now_tick_ + 1, end));
+    }
+
+    std::size_t Size() const {
+        return size_;
+    }
+
+    Clock::duration Tick() const {
+        return tick_;
+    }
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr int kLevel0Bits = 8;
+    static constexpr int kLevelBits = 6;
+    static constexpr int kLevels = 5;
+    static constexpr uint64_t kLevel0Mask = (1u << kLevel0Bits) - 1;
+    static constexpr uint64_t kLevelMask = (1u << kLevelBits) - 1;
+    static constexpr uint32_t kLists = (1u << kLevel0Bits) + (kLevels - 1) * (1u << kLevelBits);
+    static constexpr uint64_t kMaxDelta = uint64_t(1) << (kLevel0Bits + (kLevels - 1) * kLevelBits);
+
+    struct Node {
+        uint64_t expiry = 0;  // 到期的刻度
+        Callback callback = nullptr;  // 空闲的节点为 nullptr
+        void* context = nullptr;
+        uint32_t prev = kNil;
+        uint32_t next = kNil;
+        uint32_t generation = 0;
+        uint32_t list = 0;
+    };
+
+    // 第 level 层的一个槽位覆盖的刻度数的对数
+    static constexpr int Shift(int level) {
+        return level == 0 ? 0 : kLevel0Bits + (level - 1) * kLevelBits;
+    }
+
+    uint64_t TickAtOrAfter(Clock::time_point t) const {
+        if (t <= start_) return 0;
+        const auto elapsed = t - start_;
+        if (elapsed / tick_ >= static_cast<Clock::rep>(kMaxDelta) << 16) return uint64_t(kMaxDelta) << 16;
+        return (elapsed + tick_ - Clock::duration(1)) / tick_;
+    }
+
+    uint64_t TickAtOrBefore(Clock::time_point t) const {
+        if (t <= start_) return 0;
+        return (t - start_) / tick_;
+    }
+
+    Clock::time_point TimeOfTick(uint64_t tick) const {
+        return start_ + tick_ * static_cast<Clock::rep>(tick);
+    }
+
+    uint32_t Allocate() {
+        if (free_ != kNil) return std::exchange(free_, nodes_[free_].next);
+        nodes_.emplace_back();
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    // 按到期时间和当前刻度的距离选择层，层内按到期时间的对应位选择槽位
+    void Link(uint32_t index) {
+        Node& node = nodes_[index];
+        const uint64_t delta = node.expiry - now_tick_;
+        uint32_t list;
+        if (delta <= kLevel0Mask) {
+            list = static_cast<uint32_t>(node.expiry & kLevel0Mask);
+            occupied_[list / 64] |= uint64_t(1) << (list % 64);
+        } else {
+            // 太远的先放在最高层，级联时再按真正的到期时间重新放入
+            const uint64_t expiry = delta < kMaxDelta ? node.expiry : now_tick_ + kMaxDelta - 1;
+            int level = 1;
+            while ((delta >> Shift(level + 1)) != 0 && level < kLevels - 1) ++level;
+            list = (1u << kLevel0Bits) + (level - 1) * (1u << kLevelBits) +
+                   static_cast<uint32_t>((expiry >> Shift(level)) & kLevelMask);
+        }
+        node.list = list;
+        node.prev = kNil;
+        node.next = heads_[list];
+        if (node.next != kNil) nodes_[node.next].prev = index;
+        heads_[list] = index;
+    }
+
+    void Unlink(uint32_t index) {
+        Node& node = nodes_[index];
+        if (node.prev != kNil)
+            nodes_[node.prev].next = node.next;
+        else
+            heads_[node.list] = node.next;
+        if (node.next != kNil) nodes_[node.next].prev = node.prev;
+        if (node.list <= kLevel0Mask && heads_[node.list] == kNil)
+            occupied_[node.list / 64] &= ~(uint64_t(1) << (node.list % 64));
+    }
+
+    Entry Remove(uint32_t index) {
+        Unlink(index);
+        Node& node = nodes_[index];
+        Entry entry{std::exchange(node.callback, nullptr), node.context};
+        ++node.generation;
+        node.next = free_;
+        free_ = index;
+        --size_;
+        return entry;
+    }
+
+    // 第 0 层在 tick 转完一圈，从高到低把各层的当前槽位放回下层
+    void Cascade(uint64_t tick) {
+        for (int level = kLevels - 1; level >= 1; --level) {
+            if ((tick & ((uint64_t(1) << Shift(level)) - 1)) != 0) continue;
+            const uint32_t list = (1u << kLevel0Bits) + (level - 1) * (1u << kLevelBits) +
+                                  static_cast<uint32_t>((tick >> Shift(level)) & kLevelMask);
+            uint32_t index = std::exchange(heads_[list], kNil);
+            while (index != kNil) {
+                const uint32_t next = nodes_[index].next;
+                Link(index);
+                index = next;
+            }
+        }
+    }
+
+    // [from, end) 中第一个第 0 层槽位非空的刻度，没有时返回 end。两者在同一圈内
+    uint64_t NextOccupied(uint64_t from, uint64_t end) const {
+        uint32_t slot = static_cast<uint32_t>(from & kLevel0Mask);
+        const uint32_t last = static_cast<uint32_t>(std::min<uint64_t>(end - from, kLevel0Mask + 1 - slot)) + slot;
+        while (slot < last) {
+            uint64_t word = occupied_[slot / 64] >> (slot % 64);
+            if (word != 0) {
+                const uint32_t found = slot + __builtin_ctzll(word);
+                return found < last ? from + (found - (from & kLevel0Mask)) : end;
+            }
+            slot = (slot / 64 + 1) * 64;
+        }
+        return end;
+    }
+
+    const Clock::duration tick_;
+    const Clock::time_point start_;
+    uint64_t now_tick_ = 0;
+    std::size_t size_ = 0;
+    std::vector<Node> nodes_;
+    uint32_t free_ = kNil;
+    std::vector<uint32_t> heads_;
+    uint64_t occupied_[(kLevel0Mask + 1) / 64] = {};
+};
+
+// 带有后台线程的时间轮，可以在任意线程放入和取消定时器。
+// 回调在时间轮的线程里调用，调用时不持有锁，回调里可以放入和取消定时器。
+class TimerService {
+public:
+    using Clock = TimerWheel::Clock;
+
+    explicit TimerService(Clock::duration tick = std::chrono::milliseconds(1))
+        : wheel_(tick), thread_([this] { Run(); }) {}
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    // 还没到期的定时器不会再调用，只销毁
+    ~TimerService() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    template <typename Function>
+    TimerId Schedule(Clock::time_point deadline, Function function) {
+        TimerId id;
+        bool earlier;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = wheel_.Schedule(deadline, std::move(function));
+            earlier = deadline < wakeup_;
+        }
+        if (earlier) cv_.notify_one();
+        return id;
+    }
+
+    template <typename Function>
+    TimerId ScheduleAfter(Clock::duration timeout, Function function) {
+        return Schedule(Clock::now() + timeout, std::move(function));
+    }
+
+    // 返回 true 表示回调不会被调用；返回 false 表示已经到期，回调可能正在执行
+    bool Cancel(TimerId id) {
+        std::optional<TimerWheel::Entry> entry;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entry = wheel_.Take(id);
+        }
+        if (!entry) return false;
+        entry->Discard();
+        return true;
+    }
+
+    std::size_t Size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return wheel_.Size();
+    }
+
+private:
+    void Run() {
+        std::vector<TimerWheel::Entry> expired;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            wheel_.Advance(Clock::now(), [&](const TimerWheel::Entry& entry) { expired.push_back(entry); });
+            if (!expired.empty()) {
+                lock.unlock();
+                for (auto& entry : expired) entry.Fire();
+                expired.clear();
+                lock.lock();
+                continue;
+            }
+            wakeup_ = wheel_.NextWakeup();
+            if (wakeup_ == Clock::time_point::max())
+                cv_.wait(lock);
+            else
+                cv_.wait_until(lock, wakeup_);
+            wakeup_ = Clock::time_point::min();
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    TimerWheel wheel_;
+    bool stop_ = false;
+    Clock::time_point wakeup_ = Clock::time_point::min();  // 线程睡眠到的时间，醒着时为 min
+    std::thread thread_;
+};
+
+#endif // ERROR_HANDLING_TIMER_WHEEL_H_
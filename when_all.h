@@ -0,0 +1,161 @@
+#ifndef ERROR_HANDLING_WHEN_ALL_H_
+#define ERROR_HANDLING_WHEN_ALL_H_
+
+// 结构化并发的组合子，在 executor 里并行运行一组 Task：
+//
+//   WhenAll        全部成功时得到所有值；任何一个失败就以这个最先发生的错误结束，
+//                  并通知其他任务取消。
+//   WhenAny        用于对冲请求，得到最先成功的那个值及其下标，然后取消其他任务；
+//                  全部失败时返回下标最小的错误。tasks 不能为空。
+//   WhenAllSettled 等待全部完成，返回每个任务的 Result，不会取消。
+//
+// 取消是协作式的：还没开始运行的任务直接跳过，结果记为 Cancelled 错误，正在运行的任务需要
+// 自己检查传给组合子的 CancellationSource 的令牌。调用者从外部取消 source 时，WhenAll 以
+// Cancelled 结束，WhenAny 在没有任务成功时返回下标最小的错误，ErrorType 要能容纳 Cancelled。
+// 不管是否取消，组合子都会等所有子任务结束后才完成，因此子任务不会比它活得更久。
+// 完成计数只用一个原子变量，最后一个结束的子任务负责恢复等待者。
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cancellation.h"
+#include "result.h"
+#include "task.h"
+
+enum class WhenMode {
+    kAll,         // 第一个错误决定结果
+    kAny,         // 第一个成功决定结果
+    kAllSettled,  // 不提前决定
+};
+
+template <typename T, typename ErrorType>
+struct WhenState {
+    WhenState(std::size_t n, WhenMode mode, CancellationSource source)
+        : results(n), mode(mode), source(std::move(source)), remaining(n + 1) {}
+
+    // 子任务结束时调用，返回 true 表示它是最后一个
+    bool Complete(std::size_t index, Result<T, ErrorType>&& result) {
+        const bool decisive = mode == WhenMode::kAll ? !result.OK()
+                            : mode == WhenMode::kAny ? result.OK()
+                            : false;
+        results[index].emplace(std::move(result));
+        if (decisive && !decided.exchange(true, std::memory_order_relaxed)) {
+            winner = index;
+            source.Cancel();
+        }
+        return Arrive();
+    }
+
+    bool Arrive() {
+        return remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    std::vector<std::optional<Result<T, ErrorType>>> results;
+    WhenMode mode;
+    CancellationSource source;
+    std::atomic<std::size_t> remaining;
+    std::atomic<bool> decided{false};
+    std::size_t winner = 0;
+    std::coroutine_handle<> continuation;
+};
+
+template <typename Executor, typename T, typename ErrorType>
+DetachedTask WhenRunChild(Executor& executor, Task<T, ErrorType> task,
+                          WhenState<T, ErrorType>& state, std::size_t index) {
+    static_assert(std::is_constructible_v<ErrorType, Cancelled>,
+                  "the error type must be able to hold Cancelled");
+    co_await executor.Schedule();
+    bool last;
+    if (state.source.IsCancelled())
+        last = state.Complete(index, ErrorType(Cancelled(CancellationErrorCode::kCancelled)));
+    else
+        last = state.Complete(index, co_await std::move(task).AsResult());
+    if (last) state.continuation.resume();
+}
+
+// 启动所有子任务，并挂起等待者直到它们全部结束
+template <typename Executor, typename T, typename ErrorType>
+class WhenLaunchAwaiter {
+public:
+    WhenLaunchAwaiter(Executor& executor, std::vector<Task<T, ErrorType>>& tasks,
+                      WhenState<T, ErrorType>& state)
+        : executor_(executor), tasks_(tasks), state_(state) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        state_.continuation = handle;
+        for (std::size_t i = 0; i < tasks_.size(); ++i)
+            WhenRunChild(executor_, std::move(tasks_[i]), state_, i);
+        // 多出来的一个计数属于这里，如果子任务已经全部结束就不挂起
+        return !state_.Arrive();
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    Executor& executor_;
+    std::vector<Task<T, ErrorType>>& tasks_;
+    WhenState<T, ErrorType>& state_;
+};
+
+template <typename T>
+using WhenAllValue = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+template <typename Executor, typename T, typename ErrorType>
+Task<WhenAllValue<T>, ErrorType> WhenAll(Executor& executor,
+                                         std::vector<Task<T, ErrorType>> tasks,
+                                         CancellationSource source = CancellationSource()) {
+    WhenState<T, ErrorType> state(tasks.size(), WhenMode::kAll, std::move(source));
+    co_await WhenLaunchAwaiter<Executor, T, ErrorType>(executor, tasks, state);
+    if (state.decided.load(std::memory_order_relaxed)) {
+        // 等待一个失败的 Result 来结束，这样 T 为 void 时也适用
+        co_await Result<void, ErrorType>(state.results[state.winner]->Error());
+    }
+    if constexpr (std::is_void_v<T>) {
+        co_return;
+    } else {
+        std::vector<T> values;
+        values.reserve(state.results.size());
+        for (auto& result : state.results) values.push_back(std::move(result->Value()));
+        co_return values;
+    }
+}
+
+template <typename Executor, typename T, typename ErrorType>
+Task<std::pair<std::size_t, T>, ErrorType> WhenAny(
+        Executor& executor, std::vector<Task<T, ErrorType>> tasks,
+        CancellationSource source = CancellationSource()) {
+    static_assert(!std::is_void_v<T>, "WhenAny needs a value type");
+    assert(!tasks.empty());
+    WhenState<T, ErrorType> state(tasks.size(), WhenMode::kAny, std::move(source));
+    co_await WhenLaunchAwaiter<Executor, T, ErrorType>(executor, tasks, state);
+    if (state.decided.load(std::memory_order_relaxed)) {
+        co_return std::pair<std::size_t, T>(
+            state.winner, std::move(state.results[state.winner]->Value()));
+    }
+    // 没有任何一个成功，这时每个任务都运行过或者被跳过，返回下标最小的错误
+    for (auto& result : state.results) {
+        if (result && !result->OK()) co_return result->Error();
+    }
+    co_return ErrorType(Cancelled(CancellationErrorCode::kCancelled));
+}
+
+template <typename Executor, typename T, typename ErrorType>
+Task<std::vector<Result<T, ErrorType>>, ErrorType> WhenAllSettled(
+        Executor& executor, std::vector<Task<T, ErrorType>> tasks) {
+    WhenState<T, ErrorType> state(tasks.size(), WhenMode::kAllSettled, CancellationSource());
+    co_await WhenLaunchAwaiter<Executor, T, ErrorType>(executor, tasks, state);
+    std::vector<Result<T, ErrorType>> results;
+    results.reserve(state.results.size());
+    for (auto& result : state.results) results.push_back(std::move(*result));
+    co_return results;
+}
+
+#endif // ERROR_HANDLING_WHEN_ALL_H_